@@ -11,9 +11,11 @@
 #include "rmd160.c"
 #include "rmd160s.c"
 #include "sha256.c"
+#include "sha256s.c"
 
 #define HASH_BATCH_SIZE ((size_t)RMD_LEN)
 typedef u32 h160_t[5];
+typedef u32 h160x_t[5][HASH_BATCH_SIZE]; // hash160 of a batch in SoA layout: hs[word][lane]
 
 int compare_160(const void *a, const void *b) {
   const u32 *ua = (const u32 *)a;
@@ -30,12 +32,15 @@ void print_h160(const h160_t h) {
   printf("\n");
 }
 
-void prepare33(u8 msg[64], const pe *point) {
-  assert(*point->z == 1); // point should be in affine coordinates
+void h160x_get(h160_t r, const h160x_t hs, size_t lane) {
+  for (int i = 0; i < 5; i++) r[i] = hs[i][lane];
+}
 
-  msg[0] = point->y[0] & 1 ? 0x03 : 0x02;
+void prepare33_xp(u8 msg[64], const fe x, const u8 odd) {
+  // compressed pubkey needs only x and parity of y
+  msg[0] = odd ? 0x03 : 0x02;
   for (int i = 0; i < 4; i++) {
-    u64 x_be = swap64(point->x[3 - i]);
+    u64 x_be = swap64(x[3 - i]);
     memcpy(&msg[1 + i * 8], &x_be, sizeof(u64));
   }
 
@@ -44,20 +49,20 @@ void prepare33(u8 msg[64], const pe *point) {
   msg[63] = 0x08;
 }
 
-void prepare65(u8 msg[128], const pe *point) {
-  assert(*point->z == 1); // point should be in affine coordinates
+void prepare33(u8 msg[64], const fe x, const fe y) { prepare33_xp(msg, x, y[0] & 1); }
 
+void prepare65(u8 msg[128], const fe x, const fe y) {
   msg[0] = 0x04;
 
-  // copy point->x into msg[1..33] in big-endian order
+  // copy x into msg[1..33] in big-endian order
   for (int i = 0; i < 4; i++) {
-    u64 x_be = swap64(point->x[3 - i]);
+    u64 x_be = swap64(x[3 - i]);
     memcpy(&msg[1 + i * 8], &x_be, sizeof(u64));
   }
 
-  // copy point->y into msg[33..65] in big-endian order
+  // copy y into msg[33..65] in big-endian order
   for (int i = 0; i < 4; i++) {
-    u64 y_be = swap64(point->y[3 - i]);
+    u64 y_be = swap64(y[3 - i]);
     memcpy(&msg[33 + i * 8], &y_be, sizeof(u64));
   }
 
@@ -76,7 +81,8 @@ void addr33(u32 r[5], const pe *point) {
   u8 msg[64] = {0}; // sha256 payload
   u32 rs[16] = {0}; // sha256 output and rmd160 input
 
-  prepare33(msg, point);
+  assert(*point->z == 1); // point should be in affine coordinates
+  prepare33(msg, point->x, point->y);
   sha256_final(rs, msg, sizeof(msg));
 
   prepare_rmd(rs);
@@ -87,7 +93,8 @@ void addr65(u32 *r, const pe *point) {
   u8 msg[128] = {0}; // sha256 payload
   u32 rs[16] = {0};  // sha256 output and rmd160 input
 
-  prepare65(msg, point);
+  assert(*point->z == 1); // point should be in affine coordinates
+  prepare65(msg, point->x, point->y);
   sha256_final(rs, msg, sizeof(msg));
 
   prepare_rmd(rs);
@@ -95,13 +102,82 @@ void addr65(u32 *r, const pe *point) {
 }
 
 // MARK: SIMD
+// Batch functions take affine points in SoA layout: x and y coordinates in separate arrays,
+// and write hashes in SoA layout too (h160x_t)
+
+#if (!defined(__SHA__) && !defined(__ARM_FEATURE_CRYPTO) && RMD_LEN > 1) || RMD_LEN >= 16
+  // hash all lanes at once with sha256s.c (without SHA extension, or with 16 lanes where it is
+  // faster than SHA-NI one by one); pubkey words are built directly from field elements, only
+  // non-constant words are filled per lane
+  #define ADDR_SHA_LANES
+
+INLINE u32 _sha_put_fe(u32 w[][HASH_BATCH_SIZE], size_t k, size_t i, u32 lead, const fe x) {
+  // `lead` byte followed by 32 bytes of x (big-endian) from word k, returns last byte of x
+  for (int j = 0; j < 4; ++j) {
+    u64 v = x[3 - j];
+    w[k + j * 2][i] = lead << 24 | (u32)(v >> 40);
+    w[k + j * 2 + 1][i] = (u32)(v >> 8);
+    lead = v & 0xff;
+  }
+  return lead;
+}
+
+INLINE void _sha_dump(h160x_t hashes, const RMD_VEC s[8]) {
+  RMD_VEC r[5];
+  hash160_x(r, s);
+  for (int i = 0; i < 5; ++i) RMD_STORE(hashes[i], r[i]);
+}
 
-void addr33_batch(h160_t *hashes, const pe *points, size_t count) {
+void addr33_batch_xp(h160x_t hashes, const fe *xs, const u8 *odd, size_t count) {
+  assert(count <= HASH_BATCH_SIZE);
+  alignas(64) u32 w[9][HASH_BATCH_SIZE] = {0}; // sha256 words 0..8, others are constant
+
+  for (size_t i = 0; i < count; ++i) {
+    u32 last = _sha_put_fe(w, 0, i, odd[i] ? 0x03 : 0x02, xs[i]);
+    w[8][i] = last << 24 | 0x800000;
+  }
+
+  RMD_VEC s[8], v[16];
+  for (int k = 0; k < 9; ++k) v[k] = SHA_LOAD(w[k]);
+  for (int k = 9; k < 15; ++k) v[k] = RMD_LD_NUM(0);
+  v[15] = RMD_LD_NUM(33 * 8);
+
+  sha256_init_x(s);
+  sha256_block_x(s, v);
+  _sha_dump(hashes, s);
+}
+
+void addr65_batch(h160x_t hashes, const fe *xs, const fe *ys, size_t count) {
+  assert(count <= HASH_BATCH_SIZE);
+  alignas(64) u32 w[17][HASH_BATCH_SIZE] = {0}; // sha256 words 0..16, others are constant
+
+  for (size_t i = 0; i < count; ++i) {
+    u32 last = _sha_put_fe(w, 0, i, 0x04, xs[i]);
+    last = _sha_put_fe(w, 8, i, last, ys[i]);
+    w[16][i] = last << 24 | 0x800000;
+  }
+
+  RMD_VEC s[8], v[16];
+  for (int k = 0; k < 16; ++k) v[k] = SHA_LOAD(w[k]);
+  sha256_init_x(s);
+  sha256_block_x(s, v);
+
+  v[0] = SHA_LOAD(w[16]);
+  for (int k = 1; k < 15; ++k) v[k] = RMD_LD_NUM(0);
+  v[15] = RMD_LD_NUM(65 * 8);
+  sha256_block_x(s, v);
+
+  _sha_dump(hashes, s);
+}
+
+#else
+
+void addr33_batch_xp(h160x_t hashes, const fe *xs, const u8 *odd, size_t count) {
   assert(count <= HASH_BATCH_SIZE);
   u8 msg[HASH_BATCH_SIZE][64] = {0}; // sha256 payload
   u32 rs[HASH_BATCH_SIZE][16] = {0}; // sha256 output and rmd160 input
 
-  for (size_t i = 0; i < count; ++i) prepare33(msg[i], points + i);
+  for (size_t i = 0; i < count; ++i) prepare33_xp(msg[i], xs[i], odd[i]);
   for (size_t i = 0; i < count; ++i) sha256_final(rs[i], msg[i], sizeof(msg[i]));
 
   // for (size_t i = 0; i < count; ++i) prepare_rmd(rs[i]);
@@ -113,12 +189,12 @@ void addr33_batch(h160_t *hashes, const pe *points, size_t count) {
   rmd160_batch(hashes, rs);
 }
 
-void addr65_batch(h160_t *hashes, const pe *points, size_t count) {
+void addr65_batch(h160x_t hashes, const fe *xs, const fe *ys, size_t count) {
   assert(count <= HASH_BATCH_SIZE);
   u8 msg[HASH_BATCH_SIZE][128] = {0}; // sha256 payload
   u32 rs[HASH_BATCH_SIZE][16] = {0};  // sha256 output and rmd160 input
 
-  for (size_t i = 0; i < count; ++i) prepare65(msg[i], points + i);
+  for (size_t i = 0; i < count; ++i) prepare65(msg[i], xs[i], ys[i]);
   for (size_t i = 0; i < count; ++i) sha256_final(rs[i], msg[i], sizeof(msg[i]));
 
   // for (size_t i = 0; i < count; ++i) prepare_rmd(rs[i]);
@@ -129,3 +205,12 @@ void addr65_batch(h160_t *hashes, const pe *points, size_t count) {
 
   rmd160_batch(hashes, rs);
 }
+
+#endif
+
+void addr33_batch(h160x_t hashes, const fe *xs, const fe *ys, size_t count) {
+  assert(count <= HASH_BATCH_SIZE);
+  u8 odd[HASH_BATCH_SIZE];
+  for (size_t i = 0; i < count; ++i) odd[i] = ys[i][0] & 1;
+  addr33_batch_xp(hashes, xs, odd, count);
+}
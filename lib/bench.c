@@ -7,6 +7,8 @@
 
 #include "addr.c"
 #include "ecc.c"
+#include "ecc_simd.c"
+#include "fuse.c"
 #include "utils.c"
 
 void print_res(char *label, size_t stime, size_t iters) {
@@ -37,6 +39,18 @@ void run_bench() {
   print_res("_ec_jacobi_add2", stime, iters);
   assert(fe_cmp(g.x, G1.x) != 0);
 
+  pe_clone(&g, &G2);
+  stime = tsnow();
+  for (i = 0; i < iters; ++i) _ec_jacobi_madd1(&g, &g, &G1);
+  print_res("_ec_jacobi_madd1", stime, iters);
+  assert(fe_cmp(g.x, G1.x) != 0);
+
+  pe_clone(&g, &G2);
+  stime = tsnow();
+  for (i = 0; i < iters; ++i) _ec_jacobi_madd2(&g, &g, &G1);
+  print_res("_ec_jacobi_madd2", stime, iters);
+  assert(fe_cmp(g.x, G1.x) != 0);
+
   pe_clone(&g, &G2);
   stime = tsnow();
   for (i = 0; i < iters; ++i) _ec_jacobi_dbl1(&g, &g);
@@ -49,6 +63,47 @@ void run_bench() {
   print_res("_ec_jacobi_dbl2", stime, iters);
   assert(fe_cmp(g.x, G1.x) != 0);
 
+  // field arithmetic (scalar vs FE_LANES-wide batch)
+  fe fa[8], fb[8];
+  for (i = 0; i < 8; ++i) fe_prand(fa[i]), fe_prand(fb[i]);
+  iters = 1000 * 1000 * 16;
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += 8) {
+    for (size_t j = 0; j < 8; ++j) fe_modp_mul(fa[j], fa[j], fb[j]);
+  }
+  print_res("fe_modp_mul", stime, iters);
+  assert(fe_cmp(fa[0], fb[0]) != 0);
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += 8) fe_modp_mul_x8(fa, fa, fb);
+  print_res("fe_modp_mul_x8", stime, iters);
+  assert(fe_cmp(fa[0], fb[0]) != 0);
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += 8) {
+    for (size_t j = 0; j < 8; ++j) fe_modp_sqr(fa[j], fa[j]);
+  }
+  print_res("fe_modp_sqr", stime, iters);
+  assert(fe_cmp(fa[0], fb[0]) != 0);
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += 8) fe_modp_sqr_x8(fa, fa);
+  print_res("fe_modp_sqr_x8", stime, iters);
+  assert(fe_cmp(fa[0], fb[0]) != 0);
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += 8) {
+    for (size_t j = 0; j < 8; ++j) fe_modp_sub(fa[j], fa[j], fb[j]);
+  }
+  print_res("fe_modp_sub", stime, iters);
+  assert(fe_cmp(fa[0], fb[0]) != 0);
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += 8) fe_modp_sub_x8(fa, fa, fb);
+  print_res("fe_modp_sub_x8", stime, iters);
+  assert(fe_cmp(fa[0], fb[0]) != 0);
+
   // ec multiplication
   srand(42);
   size_t numSize = 1024 * 16;
@@ -96,6 +151,26 @@ void run_bench() {
   print_res("_fe_modinv_addchn", stime, iters);
   assert(fe_cmp(f, G1.x) != 0);
 
+  stime = tsnow();
+  for (i = 0; i < iters; ++i) _fe_modp_inv_safegcd(f, g.x);
+  print_res("_fe_modinv_safegcd", stime, iters);
+  assert(fe_cmp(f, G1.x) != 0);
+
+  // batch inversion (per element), chains give more ilp
+  fe gi[1024], gz[1024];
+  for (i = 0; i < 1024; ++i) fe_set64(gi[i], i + 1);
+  iters = 1000 * 1000 * 2;
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += 1024) _fe_modp_grpinv1(gi, 1024, gz);
+  print_res("_fe_modp_grpinv1", stime, iters);
+  assert(fe_cmp64(gi[0], 0) != 0);
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += 1024) _fe_modp_grpinv4(gi, 1024, gz);
+  print_res("_fe_modp_grpinv4", stime, iters);
+  assert(fe_cmp64(gi[0], 0) != 0);
+
   // hash functions
   iters = 1000 * 1000 * 10;
   h160_t h160;
@@ -109,6 +184,106 @@ void run_bench() {
   for (i = 0; i < iters; ++i) addr65(h160, &g);
   print_res("addr65", stime, iters);
   assert(h160[0] != 0);
+
+  h160x_t hs;
+  fe xs[HASH_BATCH_SIZE], ys[HASH_BATCH_SIZE];
+  for (i = 0; i < HASH_BATCH_SIZE; ++i) fe_clone(xs[i], g.x), fe_clone(ys[i], g.y);
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += HASH_BATCH_SIZE) addr33_batch(hs, xs, ys, HASH_BATCH_SIZE);
+  print_res("addr33_batch", stime, iters);
+  assert(hs[0][0] != 0);
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += HASH_BATCH_SIZE) addr65_batch(hs, xs, ys, HASH_BATCH_SIZE);
+  print_res("addr65_batch", stime, iters);
+  assert(hs[0][0] != 0);
+
+#ifdef ADDR_SHA_LANES
+  // sha256 -> rmd160 handoff: via u32[lane][16] (scatter + gather) vs in registers
+  RMD_VEC sv[8], rv[5];
+  u32 rs[HASH_BATCH_SIZE][16] = {0}, tmp[HASH_BATCH_SIZE];
+  sha256_init_x(sv);
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += HASH_BATCH_SIZE) {
+    for (int k = 0; k < 8; ++k) {
+      RMD_STORE(tmp, sv[k]);
+      for (size_t j = 0; j < HASH_BATCH_SIZE; ++j) rs[j][k] = tmp[j];
+    }
+    for (size_t j = 0; j < HASH_BATCH_SIZE; ++j) rs[j][8] = 0x80000000, rs[j][14] = 0x00010000;
+    rmd160_batch(hs, rs);
+    sv[0] = RMD_ADD2(sv[0], RMD_LD_NUM(hs[0][0]));
+  }
+  print_res("hash160_gather", stime, iters);
+  assert(hs[0][0] != 0);
+
+  sha256_init_x(sv);
+  stime = tsnow();
+  for (i = 0; i < iters; i += HASH_BATCH_SIZE) {
+    hash160_x(rv, sv);
+    sv[0] = RMD_ADD2(sv[0], rv[0]);
+  }
+  print_res("hash160_x", stime, iters);
+  RMD_STORE(hs[0], rv[0]);
+  assert(hs[0][0] != 0);
+#endif
+
+  // bloom filter probe by index reduction (queries are random, so almost all are misses)
+  const char *idx_names[] = {"mod", "pow2", "fast"};
+  size_t blf_items = 1024 * 1024, nbatch = 1024;
+  h160x_t *qs = malloc(nbatch * sizeof(h160x_t));
+  for (i = 0; i < nbatch * sizeof(h160x_t) / sizeof(u32); ++i) ((u32 *)qs)[i] = _prand64();
+
+  iters = 1000 * 1000 * 16;
+  for (u32 v = 1; v <= 2; ++v) {
+    for (u32 idx = BLF_IDX_MOD; idx <= BLF_IDX_FAST; ++idx) {
+      blf_t blf;
+      blf_init(&blf, blf_size(blf_items, v, idx), v, idx);
+      for (size_t j = 0; j < blf_items; ++j) {
+        for (size_t k = 0; k < 5; ++k) h160[k] = _prand64();
+        blf_add(&blf, h160);
+      }
+
+      u32 mask, hits = 0;
+      stime = tsnow();
+      for (i = 0; i < iters; i += HASH_BATCH_SIZE) {
+        blf_has_batch(&blf, qs[(i / HASH_BATCH_SIZE) % nbatch], HASH_BATCH_SIZE, &mask);
+        hits += __builtin_popcount(mask);
+      }
+
+      char label[32];
+      snprintf(label, sizeof(label), "blf_has_v%u_%s", v, idx_names[idx]);
+      print_res(label, stime, iters);
+      assert(hits < iters);
+      free(blf.bits);
+    }
+  }
+
+  // binary fuse filter on the same number of items
+  u64 *keys = malloc(blf_items * sizeof(u64));
+  for (size_t j = 0; j < blf_items; ++j) keys[j] = _prand64();
+  for (u32 bits = 16; bits <= 32; bits += 16) {
+    fuse_t fuse;
+    bool built = fuse_build(&fuse, keys, blf_items, bits);
+    assert(built);
+
+    u32 mask, hits = 0;
+    stime = tsnow();
+    for (i = 0; i < iters; i += HASH_BATCH_SIZE) {
+      fuse_has_batch(&fuse, qs[(i / HASH_BATCH_SIZE) % nbatch], HASH_BATCH_SIZE, &mask);
+      hits += __builtin_popcount(mask);
+    }
+
+    char label[32];
+    snprintf(label, sizeof(label), "fuse_has_%u", bits);
+    print_res(label, stime, iters);
+    assert(hits < iters);
+    fuse_free(&fuse);
+  }
+
+  free(keys);
+  free(qs);
 }
 
 void run_bench_gtable() {
@@ -140,7 +315,96 @@ void run_bench_gtable() {
   }
 }
 
+void _simd_verify_fail(const char *label, size_t i, const fe a, const fe b, const fe r1,
+                       const fe r2) {
+  printf("invalid %s on %zu\n", label, i);
+  fe_print("a", a);
+  fe_print("b", b);
+  fe_print("scalar", r1);
+  fe_print("simd", r2);
+  exit(1);
+}
+
+void simd_verify() {
+  // _x8 / lanes functions must give same result as scalar ones (random values & near limbs / P)
+  const size_t nr = 8 * 256, ns = 24;
+  fe vs[ns + nr];
+  memset(vs, 0, sizeof(vs));
+  fe_set64(vs[1], 1);
+  fe_set64(vs[2], 2);
+  fe_set64(vs[3], (1ull << 52) - 1);
+  fe_set64(vs[4], (1ull << 26) - 1);
+  for (size_t i = 0; i < 8; ++i) fe_modp_sub(vs[5 + i], FE_P, vs[1 + i % 4]); // P-1, P-2, ..
+  fe_modp_sub(vs[9], vs[5], vs[5]);
+  for (size_t i = 10; i < ns; ++i) {
+    // 2^k - 1 and 2^k on limb boundaries (26 / 52 bit), all < P
+    u32 k = (u32[]){26, 52, 78, 104, 130, 156, 208, 255}[(i - 10) % 8];
+    fe_set64(vs[i], 1);
+    fe_shiftl(vs[i], k);
+    if (i >= 18) fe_modp_sub(vs[i], vs[i], vs[1]);
+  }
+  for (size_t i = ns; i < ns + nr; ++i) fe_prand(vs[i]);
+
+  const size_t n = ns + nr;
+  fe a[8], b[8], r[8], t;
+  for (size_t i = 0; i < n * 4; i += 8) {
+    // all pairs of special values, then random ones
+    for (size_t j = 0; j < 8; ++j) {
+      size_t k = i + j;
+      fe_clone(a[j], vs[k < ns * ns ? k / ns : k % n]);
+      fe_clone(b[j], vs[k < ns * ns ? k % ns : (k * 7 + 3) % n]);
+    }
+
+    fe_modp_mul_x8(r, a, b);
+    for (size_t j = 0; j < 8; ++j) {
+      fe_modp_mul(t, a[j], b[j]);
+      if (fe_cmp(t, r[j]) != 0) _simd_verify_fail("fe_modp_mul_x8", i + j, a[j], b[j], t, r[j]);
+    }
+
+    fe_modp_sqr_x8(r, a);
+    for (size_t j = 0; j < 8; ++j) {
+      fe_modp_sqr(t, a[j]);
+      if (fe_cmp(t, r[j]) != 0) _simd_verify_fail("fe_modp_sqr_x8", i + j, a[j], a[j], t, r[j]);
+    }
+
+    fe_modp_sub_x8(r, a, b);
+    for (size_t j = 0; j < 8; ++j) {
+      fe_modp_sub(t, a[j], b[j]);
+      if (fe_cmp(t, r[j]) != 0) _simd_verify_fail("fe_modp_sub_x8", i + j, a[j], b[j], t, r[j]);
+    }
+  }
+
+#if FE_LANES > 1
+  // affine addition of FE_LANES points to one point, as in batch_add
+  pe p1, p2, q;
+  fe x2[FE_LANES], y2[FE_LANES], dx[FE_LANES], rx[FE_LANES], ry[FE_LANES], k;
+  for (size_t i = 0; i < 256; ++i) {
+    fe_prand(k);
+    ec_jacobi_mulrdc(&p1, &G1, k);
+    for (size_t j = 0; j < FE_LANES; ++j) {
+      fe_prand(k);
+      ec_jacobi_mulrdc(&p2, &G1, k);
+      fe_clone(x2[j], p2.x);
+      fe_clone(y2[j], p2.y);
+      fe_modp_sub(dx[j], p2.x, p1.x);
+      fe_modp_inv(dx[j], dx[j]);
+    }
+
+    ec_affine_add_lanes(rx, ry, p1.x, p1.y, x2, y2, dx);
+    for (size_t j = 0; j < FE_LANES; ++j) {
+      fe_clone(p2.x, x2[j]);
+      fe_clone(p2.y, y2[j]);
+      ec_affine_add(&q, &p1, &p2);
+      if (fe_cmp(q.x, rx[j]) != 0 || fe_cmp(q.y, ry[j]) != 0) {
+        _simd_verify_fail("ec_affine_add_lanes", i, p1.x, p2.x, q.x, rx[j]);
+      }
+    }
+  }
+#endif
+}
+
 void mult_verify() {
+  simd_verify();
   ec_gtable_init();
 
   pe r1, r2;
@@ -4,8 +4,10 @@
 #define HAS_BUILTIN(fn) (USE_BUILTIN && __has_builtin(fn))
 
 typedef __uint128_t u128;
+typedef __int128_t i128;
 typedef unsigned long long u64;
 typedef unsigned int u32;
+typedef unsigned short u16;
 typedef unsigned char u8;
 #define INLINE static inline __attribute__((always_inline))
 
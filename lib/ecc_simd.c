@@ -0,0 +1,474 @@
+// Copyright (c) vladkens
+// https://github.com/vladkens/ecloop
+// Licensed under the MIT License.
+
+#pragma once
+#include <stdalign.h>
+
+#include "ecc.c"
+
+// Vectorized modulo P arithmetic: FE_LANES independent field elements processed at once.
+// Values are loaded from / stored to regular `fe` arrays (canonical 4x64), inside kernels
+// other radix is used, so keep as much work as possible between fev_load and fev_store.
+
+#if defined(__x86_64__) && defined(__AVX512F__) && defined(__AVX512IFMA__) && !defined(NO_SIMD)
+  #include <immintrin.h>
+
+  // 8 lanes, 5x52 bit limbs (a0 + a1*2^52 + a2*2^104 + a3*2^156 + a4*2^208)
+  // limbs are kept below 2^52 after each operation (value may be >= P, but < 2^260)
+  #define FE_LANES 8
+
+typedef struct fev {
+  __m512i v[5];
+} fev;
+
+  #define FE52_M 0xfffffffffffffULL // 52 bit mask
+  #define FE52_R 0x1000003D10ULL    // 2^260 mod P
+  #define FE52_P 0x1000003D1ULL     // 2^256 mod P
+
+INLINE void _fev_carry(__m512i r[5]) {
+  const __m512i M = _mm512_set1_epi64(FE52_M);
+  for (int i = 0; i < 4; ++i) {
+    r[i + 1] = _mm512_add_epi64(r[i + 1], _mm512_srli_epi64(r[i], 52));
+    r[i] = _mm512_and_si512(r[i], M);
+  }
+}
+
+INLINE void _fev_norm(__m512i r[5]) {
+  // limbs up to 2^62 -> limbs below 2^52 (bits above 2^260 folded back with R)
+  const __m512i M = _mm512_set1_epi64(FE52_M);
+  const __m512i R = _mm512_set1_epi64(FE52_R);
+  __m512i t;
+
+  _fev_carry(r);
+  t = _mm512_srli_epi64(r[4], 52);
+  r[4] = _mm512_and_si512(r[4], M);
+  r[0] = _mm512_madd52lo_epu64(r[0], t, R);
+
+  // second pass can carry only when value was near 2^260, then upper limbs are small
+  _fev_carry(r);
+  t = _mm512_srli_epi64(r[4], 52);
+  r[4] = _mm512_and_si512(r[4], M);
+  r[0] = _mm512_madd52lo_epu64(r[0], t, R);
+  r[1] = _mm512_add_epi64(r[1], _mm512_srli_epi64(r[0], 52));
+  r[0] = _mm512_and_si512(r[0], M);
+}
+
+INLINE void _fev_reduce(fev *r, __m512i c[10]) {
+  // 520bit product in 10 columns -> 260bit
+  const __m512i M = _mm512_set1_epi64(FE52_M);
+  const __m512i R = _mm512_set1_epi64(FE52_R);
+  const __m512i Z = _mm512_setzero_si512();
+
+  // columns to 52 bit limbs (required by madd52 inputs)
+  for (int i = 0; i < 9; ++i) {
+    c[i + 1] = _mm512_add_epi64(c[i + 1], _mm512_srli_epi64(c[i], 52));
+    c[i] = _mm512_and_si512(c[i], M);
+  }
+
+  // c[5..9] * 2^260 = c[5..9] * R (mod P)
+  __m512i t = Z;
+  for (int i = 0; i < 5; ++i) {
+    c[i] = _mm512_madd52lo_epu64(c[i], c[i + 5], R);
+    if (i < 4) c[i + 1] = _mm512_madd52hi_epu64(c[i + 1], c[i + 5], R);
+    else t = _mm512_madd52hi_epu64(t, c[i + 5], R);
+  }
+
+  // t < 2^37, fold once more
+  c[0] = _mm512_madd52lo_epu64(c[0], t, R);
+  c[1] = _mm512_madd52hi_epu64(c[1], t, R);
+
+  for (int i = 0; i < 5; ++i) r->v[i] = c[i];
+  _fev_norm(r->v);
+}
+
+INLINE void fev_mul(fev *r, const fev *a, const fev *b) {
+  __m512i c[10];
+  for (int i = 0; i < 10; ++i) c[i] = _mm512_setzero_si512();
+
+  for (int i = 0; i < 5; ++i) {
+    for (int j = 0; j < 5; ++j) {
+      c[i + j] = _mm512_madd52lo_epu64(c[i + j], a->v[i], b->v[j]);
+      c[i + j + 1] = _mm512_madd52hi_epu64(c[i + j + 1], a->v[i], b->v[j]);
+    }
+  }
+
+  _fev_reduce(r, c);
+}
+
+INLINE void fev_sqr(fev *r, const fev *a) {
+  __m512i c[10];
+  for (int i = 0; i < 10; ++i) c[i] = _mm512_setzero_si512();
+
+  // cross products once, then doubled (madd52 inputs can't be doubled, 53 bits)
+  for (int i = 0; i < 5; ++i) {
+    for (int j = i + 1; j < 5; ++j) {
+      c[i + j] = _mm512_madd52lo_epu64(c[i + j], a->v[i], a->v[j]);
+      c[i + j + 1] = _mm512_madd52hi_epu64(c[i + j + 1], a->v[i], a->v[j]);
+    }
+  }
+
+  for (int i = 0; i < 10; ++i) c[i] = _mm512_slli_epi64(c[i], 1);
+
+  for (int i = 0; i < 5; ++i) {
+    c[2 * i] = _mm512_madd52lo_epu64(c[2 * i], a->v[i], a->v[i]);
+    c[2 * i + 1] = _mm512_madd52hi_epu64(c[2 * i + 1], a->v[i], a->v[i]);
+  }
+
+  _fev_reduce(r, c);
+}
+
+INLINE void fev_sub(fev *r, const fev *a, const fev *b) {
+  // a - b + 32 * P, where 32 * P limbs are all above 2^52 (so no limb underflow)
+  const __m512i D0 = _mm512_set1_epi64((1ULL << 53) - 2 * FE52_R);
+  const __m512i D1 = _mm512_set1_epi64((1ULL << 53) - 2);
+
+  r->v[0] = _mm512_sub_epi64(_mm512_add_epi64(a->v[0], D0), b->v[0]);
+  for (int i = 1; i < 5; ++i) r->v[i] = _mm512_sub_epi64(_mm512_add_epi64(a->v[i], D1), b->v[i]);
+  _fev_norm(r->v);
+}
+
+INLINE void _fev_from64(__m512i r[5], const __m512i x[4]) {
+  const __m512i M = _mm512_set1_epi64(FE52_M);
+  r[0] = _mm512_and_si512(x[0], M);
+  r[1] = _mm512_and_si512(_mm512_or_si512(_mm512_srli_epi64(x[0], 52), _mm512_slli_epi64(x[1], 12)), M);
+  r[2] = _mm512_and_si512(_mm512_or_si512(_mm512_srli_epi64(x[1], 40), _mm512_slli_epi64(x[2], 24)), M);
+  r[3] = _mm512_and_si512(_mm512_or_si512(_mm512_srli_epi64(x[2], 28), _mm512_slli_epi64(x[3], 36)), M);
+  r[4] = _mm512_srli_epi64(x[3], 16);
+}
+
+INLINE void fev_set1(fev *r, const fe a) {
+  __m512i x[4];
+  for (int i = 0; i < 4; ++i) x[i] = _mm512_set1_epi64(a[i]);
+  _fev_from64(r->v, x);
+}
+
+INLINE void fev_load(fev *r, const fe a[FE_LANES]) {
+  // 8 x 4x64 (point-major) -> 4 x 8x64 (limb-major)
+  const __m512i I0 = _mm512_setr_epi64(0, 4, 8, 12, 1, 5, 9, 13);
+  const __m512i I1 = _mm512_setr_epi64(2, 6, 10, 14, 3, 7, 11, 15);
+  const __m512i I2 = _mm512_setr_epi64(0, 1, 2, 3, 8, 9, 10, 11);
+  const __m512i I3 = _mm512_setr_epi64(4, 5, 6, 7, 12, 13, 14, 15);
+
+  const u64 *p = (const u64 *)a;
+  __m512i z0 = _mm512_loadu_si512(p + 0), z1 = _mm512_loadu_si512(p + 8);
+  __m512i z2 = _mm512_loadu_si512(p + 16), z3 = _mm512_loadu_si512(p + 24);
+
+  __m512i t0 = _mm512_permutex2var_epi64(z0, I0, z1), t1 = _mm512_permutex2var_epi64(z0, I1, z1);
+  __m512i t2 = _mm512_permutex2var_epi64(z2, I0, z3), t3 = _mm512_permutex2var_epi64(z2, I1, z3);
+
+  __m512i x[4];
+  x[0] = _mm512_permutex2var_epi64(t0, I2, t2);
+  x[1] = _mm512_permutex2var_epi64(t0, I3, t2);
+  x[2] = _mm512_permutex2var_epi64(t1, I2, t3);
+  x[3] = _mm512_permutex2var_epi64(t1, I3, t3);
+  _fev_from64(r->v, x);
+}
+
+INLINE void fev_store(fe r[FE_LANES], const fev *a) {
+  const __m512i M48 = _mm512_set1_epi64(0xffffffffffffULL);
+  const __m512i P = _mm512_set1_epi64(FE52_P);
+  __m512i v[5], t[5], c;
+  for (int i = 0; i < 5; ++i) v[i] = a->v[i];
+
+  // fold bits above 2^256 (twice, second time only for values near 2^256)
+  for (int k = 0; k < 2; ++k) {
+    c = _mm512_srli_epi64(v[4], 48);
+    v[4] = _mm512_and_si512(v[4], M48);
+    v[0] = _mm512_madd52lo_epu64(v[0], c, P);
+    _fev_carry(v);
+  }
+
+  // if v >= P then v + (2^256 - P) overflows 2^256, use it instead
+  for (int i = 0; i < 5; ++i) t[i] = v[i];
+  t[0] = _mm512_add_epi64(t[0], P);
+  _fev_carry(t);
+  __mmask8 ge = _mm512_test_epi64_mask(t[4], _mm512_set1_epi64(1ULL << 48));
+  t[4] = _mm512_and_si512(t[4], M48);
+  for (int i = 0; i < 5; ++i) v[i] = _mm512_mask_blend_epi64(ge, v[i], t[i]);
+
+  // 5x52 -> 4x64
+  __m512i x[4];
+  x[0] = _mm512_or_si512(v[0], _mm512_slli_epi64(v[1], 52));
+  x[1] = _mm512_or_si512(_mm512_srli_epi64(v[1], 12), _mm512_slli_epi64(v[2], 40));
+  x[2] = _mm512_or_si512(_mm512_srli_epi64(v[2], 24), _mm512_slli_epi64(v[3], 28));
+  x[3] = _mm512_or_si512(_mm512_srli_epi64(v[3], 36), _mm512_slli_epi64(v[4], 16));
+
+  // 4 x 8x64 (limb-major) -> 8 x 4x64 (point-major), same permutations as in fev_load
+  const __m512i I0 = _mm512_setr_epi64(0, 4, 8, 12, 1, 5, 9, 13);
+  const __m512i I1 = _mm512_setr_epi64(2, 6, 10, 14, 3, 7, 11, 15);
+  const __m512i I2 = _mm512_setr_epi64(0, 1, 2, 3, 8, 9, 10, 11);
+  const __m512i I3 = _mm512_setr_epi64(4, 5, 6, 7, 12, 13, 14, 15);
+
+  __m512i t0 = _mm512_permutex2var_epi64(x[0], I2, x[1]), t2 = _mm512_permutex2var_epi64(x[0], I3, x[1]);
+  __m512i t1 = _mm512_permutex2var_epi64(x[2], I2, x[3]), t3 = _mm512_permutex2var_epi64(x[2], I3, x[3]);
+
+  u64 *p = (u64 *)r;
+  _mm512_storeu_si512(p + 0, _mm512_permutex2var_epi64(t0, I0, t1));
+  _mm512_storeu_si512(p + 8, _mm512_permutex2var_epi64(t0, I1, t1));
+  _mm512_storeu_si512(p + 16, _mm512_permutex2var_epi64(t2, I0, t3));
+  _mm512_storeu_si512(p + 24, _mm512_permutex2var_epi64(t2, I1, t3));
+}
+
+#elif defined(__x86_64__) && defined(__AVX2__) && !defined(NO_SIMD)
+  #include <immintrin.h>
+
+  // 4 lanes, 10x26 bit limbs in 64 bit slots (products of two limbs fit _mm256_mul_epu32)
+  // limbs are kept below 2^26 after each operation (value may be >= P, but < 2^260)
+  #define FE_LANES 4
+
+typedef struct fev {
+  __m256i v[10];
+} fev;
+
+  #define FE26_M 0x3ffffffULL // 26 bit mask
+  #define FE26_R 0x3D10ULL    // 2^260 mod P = 0x3D10 + 2^10 * 2^26
+  #define FE26_P 0x3D1ULL     // 2^256 mod P = 0x3D1 + 2^6 * 2^26
+
+INLINE void _fev_carry(__m256i r[10]) {
+  const __m256i M = _mm256_set1_epi64x(FE26_M);
+  for (int i = 0; i < 9; ++i) {
+    r[i + 1] = _mm256_add_epi64(r[i + 1], _mm256_srli_epi64(r[i], 26));
+    r[i] = _mm256_and_si256(r[i], M);
+  }
+}
+
+INLINE void _fev_fold(__m256i r[10], __m256i t) {
+  // r += t * 2^260, t < 2^52 (mul_epu32 takes only low 32 bits, so in two parts)
+  const __m256i R = _mm256_set1_epi64x(FE26_R);
+  __m256i lo = _mm256_mul_epu32(t, R);
+  __m256i hi = _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(t, 32), R), 32);
+  r[0] = _mm256_add_epi64(r[0], _mm256_add_epi64(lo, hi));
+  r[1] = _mm256_add_epi64(r[1], _mm256_slli_epi64(t, 10));
+}
+
+INLINE void _fev_norm(__m256i r[10]) {
+  // limbs up to 2^63 -> limbs below 2^26 (bits above 2^260 folded back with R)
+  const __m256i M = _mm256_set1_epi64x(FE26_M);
+  __m256i t;
+
+  _fev_carry(r);
+  t = _mm256_srli_epi64(r[9], 26);
+  r[9] = _mm256_and_si256(r[9], M);
+  _fev_fold(r, t);
+
+  // second pass can carry only when value was near 2^260, then upper limbs are small
+  _fev_carry(r);
+  t = _mm256_srli_epi64(r[9], 26);
+  r[9] = _mm256_and_si256(r[9], M);
+  _fev_fold(r, t);
+  r[1] = _mm256_add_epi64(r[1], _mm256_srli_epi64(r[0], 26));
+  r[0] = _mm256_and_si256(r[0], M);
+}
+
+INLINE void _fev_reduce(fev *r, __m256i c[20]) {
+  // 520bit product in 19 columns (up to 2^56 each) -> 260bit
+  const __m256i M = _mm256_set1_epi64x(FE26_M);
+  const __m256i R = _mm256_set1_epi64x(FE26_R);
+
+  c[19] = _mm256_setzero_si256();
+  for (int i = 0; i < 19; ++i) {
+    c[i + 1] = _mm256_add_epi64(c[i + 1], _mm256_srli_epi64(c[i], 26));
+    c[i] = _mm256_and_si256(c[i], M);
+  }
+
+  // c[10..19] * 2^260 = c[10..19] * R (mod P), c[19] goes to the top limb as is
+  for (int i = 0; i < 9; ++i) {
+    c[i] = _mm256_add_epi64(c[i], _mm256_mul_epu32(c[i + 10], R));
+    c[i + 1] = _mm256_add_epi64(c[i + 1], _mm256_slli_epi64(c[i + 10], 10));
+  }
+  c[9] = _mm256_add_epi64(c[9], _mm256_mul_epu32(c[19], R));
+  c[9] = _mm256_add_epi64(c[9], _mm256_slli_epi64(c[19], 36));
+
+  for (int i = 0; i < 10; ++i) r->v[i] = c[i];
+  _fev_norm(r->v);
+}
+
+INLINE void fev_mul(fev *r, const fev *a, const fev *b) {
+  __m256i c[20];
+  for (int i = 0; i < 20; ++i) c[i] = _mm256_setzero_si256();
+
+  for (int i = 0; i < 10; ++i) {
+    for (int j = 0; j < 10; ++j) {
+      c[i + j] = _mm256_add_epi64(c[i + j], _mm256_mul_epu32(a->v[i], b->v[j]));
+    }
+  }
+
+  _fev_reduce(r, c);
+}
+
+INLINE void fev_sqr(fev *r, const fev *a) {
+  __m256i c[20], d[10];
+  for (int i = 0; i < 20; ++i) c[i] = _mm256_setzero_si256();
+  for (int i = 0; i < 10; ++i) d[i] = _mm256_add_epi64(a->v[i], a->v[i]);
+
+  // cross products once with doubled operand, still fits 32 bit multiplier
+  for (int i = 0; i < 10; ++i) {
+    c[2 * i] = _mm256_add_epi64(c[2 * i], _mm256_mul_epu32(a->v[i], a->v[i]));
+    for (int j = i + 1; j < 10; ++j) {
+      c[i + j] = _mm256_add_epi64(c[i + j], _mm256_mul_epu32(a->v[i], d[j]));
+    }
+  }
+
+  _fev_reduce(r, c);
+}
+
+INLINE void fev_sub(fev *r, const fev *a, const fev *b) {
+  // a - b + (2^261 - 2R), which is 0 mod P and has all limbs above 2^26 (so no limb underflow)
+  const __m256i D0 = _mm256_set1_epi64x((1ULL << 27) - 2 * FE26_R);
+  const __m256i D1 = _mm256_set1_epi64x((1ULL << 27) - 2 - (2 << 10));
+  const __m256i D2 = _mm256_set1_epi64x((1ULL << 27) - 2);
+
+  r->v[0] = _mm256_sub_epi64(_mm256_add_epi64(a->v[0], D0), b->v[0]);
+  r->v[1] = _mm256_sub_epi64(_mm256_add_epi64(a->v[1], D1), b->v[1]);
+  for (int i = 2; i < 10; ++i) r->v[i] = _mm256_sub_epi64(_mm256_add_epi64(a->v[i], D2), b->v[i]);
+  _fev_norm(r->v);
+}
+
+INLINE void _fev_from64(__m256i r[10], const __m256i x[4]) {
+  const __m256i M = _mm256_set1_epi64x(FE26_M);
+  r[0] = _mm256_and_si256(x[0], M);
+  r[1] = _mm256_and_si256(_mm256_srli_epi64(x[0], 26), M);
+  r[2] = _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(x[0], 52), _mm256_slli_epi64(x[1], 12)), M);
+  r[3] = _mm256_and_si256(_mm256_srli_epi64(x[1], 14), M);
+  r[4] = _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(x[1], 40), _mm256_slli_epi64(x[2], 24)), M);
+  r[5] = _mm256_and_si256(_mm256_srli_epi64(x[2], 2), M);
+  r[6] = _mm256_and_si256(_mm256_srli_epi64(x[2], 28), M);
+  r[7] = _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(x[2], 54), _mm256_slli_epi64(x[3], 10)), M);
+  r[8] = _mm256_and_si256(_mm256_srli_epi64(x[3], 16), M);
+  r[9] = _mm256_srli_epi64(x[3], 42);
+}
+
+INLINE void _fev_transpose(__m256i x[4]) {
+  // 4x4 matrix of 64 bit values, used both ways (point-major <-> limb-major)
+  __m256i t0 = _mm256_unpacklo_epi64(x[0], x[1]), t1 = _mm256_unpackhi_epi64(x[0], x[1]);
+  __m256i t2 = _mm256_unpacklo_epi64(x[2], x[3]), t3 = _mm256_unpackhi_epi64(x[2], x[3]);
+  x[0] = _mm256_permute2x128_si256(t0, t2, 0x20);
+  x[1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+  x[2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+  x[3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+}
+
+INLINE void fev_set1(fev *r, const fe a) {
+  __m256i x[4];
+  for (int i = 0; i < 4; ++i) x[i] = _mm256_set1_epi64x(a[i]);
+  _fev_from64(r->v, x);
+}
+
+INLINE void fev_load(fev *r, const fe a[FE_LANES]) {
+  __m256i x[4];
+  for (int i = 0; i < 4; ++i) x[i] = _mm256_loadu_si256((const __m256i *)a[i]);
+  _fev_transpose(x);
+  _fev_from64(r->v, x);
+}
+
+INLINE void fev_store(fe r[FE_LANES], const fev *a) {
+  const __m256i M22 = _mm256_set1_epi64x(0x3fffffULL);
+  const __m256i B22 = _mm256_set1_epi64x(1ULL << 22);
+  const __m256i P = _mm256_set1_epi64x(FE26_P);
+  __m256i v[10], t[10], c;
+  for (int i = 0; i < 10; ++i) v[i] = a->v[i];
+
+  // fold bits above 2^256 (twice, second time only for values near 2^256)
+  for (int k = 0; k < 2; ++k) {
+    c = _mm256_srli_epi64(v[9], 22);
+    v[9] = _mm256_and_si256(v[9], M22);
+    v[0] = _mm256_add_epi64(v[0], _mm256_mul_epu32(c, P));
+    v[1] = _mm256_add_epi64(v[1], _mm256_slli_epi64(c, 6));
+    _fev_carry(v);
+  }
+
+  // if v >= P then v + (2^256 - P) overflows 2^256, use it instead
+  for (int i = 0; i < 10; ++i) t[i] = v[i];
+  t[0] = _mm256_add_epi64(t[0], P);
+  t[1] = _mm256_add_epi64(t[1], _mm256_set1_epi64x(1 << 6));
+  _fev_carry(t);
+  __m256i ge = _mm256_cmpeq_epi64(_mm256_and_si256(t[9], B22), B22);
+  t[9] = _mm256_and_si256(t[9], M22);
+  for (int i = 0; i < 10; ++i) v[i] = _mm256_blendv_epi8(v[i], t[i], ge);
+
+  // 10x26 -> 4x64
+  __m256i x[4];
+  x[0] = _mm256_or_si256(_mm256_or_si256(v[0], _mm256_slli_epi64(v[1], 26)), _mm256_slli_epi64(v[2], 52));
+  x[1] = _mm256_or_si256(_mm256_or_si256(_mm256_srli_epi64(v[2], 12), _mm256_slli_epi64(v[3], 14)),
+                         _mm256_slli_epi64(v[4], 40));
+  x[2] = _mm256_or_si256(_mm256_or_si256(_mm256_srli_epi64(v[4], 24), _mm256_slli_epi64(v[5], 2)),
+                         _mm256_or_si256(_mm256_slli_epi64(v[6], 28), _mm256_slli_epi64(v[7], 54)));
+  x[3] = _mm256_or_si256(_mm256_or_si256(_mm256_srli_epi64(v[7], 10), _mm256_slli_epi64(v[8], 16)),
+                         _mm256_slli_epi64(v[9], 42));
+
+  _fev_transpose(x);
+  for (int i = 0; i < 4; ++i) _mm256_storeu_si256((__m256i *)r[i], x[i]);
+}
+
+#else
+  #define FE_LANES 1
+#endif
+
+// MARK: Batch API
+
+void fe_modp_mul_x8(fe r[8], const fe a[8], const fe b[8]) {
+#if FE_LANES > 1
+  fev va, vb;
+  for (int i = 0; i < 8; i += FE_LANES) {
+    fev_load(&va, a + i);
+    fev_load(&vb, b + i);
+    fev_mul(&va, &va, &vb);
+    fev_store(r + i, &va);
+  }
+#else
+  for (int i = 0; i < 8; ++i) fe_modp_mul(r[i], a[i], b[i]);
+#endif
+}
+
+void fe_modp_sqr_x8(fe r[8], const fe a[8]) {
+#if FE_LANES > 1
+  fev va;
+  for (int i = 0; i < 8; i += FE_LANES) {
+    fev_load(&va, a + i);
+    fev_sqr(&va, &va);
+    fev_store(r + i, &va);
+  }
+#else
+  for (int i = 0; i < 8; ++i) fe_modp_sqr(r[i], a[i]);
+#endif
+}
+
+void fe_modp_sub_x8(fe r[8], const fe a[8], const fe b[8]) {
+#if FE_LANES > 1
+  fev va, vb;
+  for (int i = 0; i < 8; i += FE_LANES) {
+    fev_load(&va, a + i);
+    fev_load(&vb, b + i);
+    fev_sub(&va, &va, &vb);
+    fev_store(r + i, &va);
+  }
+#else
+  for (int i = 0; i < 8; ++i) fe_modp_sub(r[i], a[i], b[i]);
+#endif
+}
+
+#if FE_LANES > 1
+void ec_affine_add_lanes(fe rx[FE_LANES], fe ry[FE_LANES], const fe x1, const fe y1,
+                         const fe x2[FE_LANES], const fe y2[FE_LANES], const fe dxinv[FE_LANES]) {
+  // same as batch_add step, but for FE_LANES points with precomputed 1 / (x2 - x1)
+  fev X1, Y1, X2, Y2, ss, tx, ty;
+  fev_set1(&X1, x1);
+  fev_set1(&Y1, y1);
+  fev_load(&X2, x2);
+  fev_load(&Y2, y2);
+  fev_load(&ss, dxinv);
+
+  fev_sub(&ty, &Y2, &Y1);  // y2 - y1
+  fev_mul(&ss, &ty, &ss);  // λ = (y2 - y1) / (x2 - x1)
+  fev_sqr(&tx, &ss);       // λ²
+  fev_sub(&tx, &tx, &X1);  // λ² - x1
+  fev_sub(&tx, &tx, &X2);  // rx = λ² - x1 - x2
+  fev_sub(&ty, &X1, &tx);  // x1 - rx
+  fev_mul(&ty, &ss, &ty);  // λ * (x1 - rx)
+  fev_sub(&ty, &ty, &Y1);  // ry = λ * (x1 - rx) - y1
+
+  fev_store(rx, &tx);
+  fev_store(ry, &ty);
+}
+#endif
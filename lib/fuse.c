@@ -0,0 +1,374 @@
+// Copyright (c) vladkens
+// https://github.com/vladkens/ecloop
+// Licensed under the MIT License.
+
+#pragma once
+#include "utils.c"
+
+// Binary fuse filter (3-wise) for a static set of hash160, see https://arxiv.org/abs/2201.01174
+// and https://github.com/FastFilter/xor_singleheader. Lookup is three reads (close to each
+// other, in 3 consecutive segments), ~1.13 * fp_bits bits per key, false positive rate 2^-fp_bits.
+// Filter can not be updated, it is built once from full list of hashes with fuse-gen command.
+
+#define FUSE_MAGIC 0x45434646 // FourCC: ECFF
+#define FUSE_VERSION 1
+#define FUSE_MAX_ITERATIONS 100
+
+typedef struct fuse_t {
+  u64 seed;
+  u32 fp_bits; // 16 or 32
+  u32 seg_len;
+  u32 seg_mask;
+  u32 seg_count_len;
+  u32 array_len;
+  void *fps;       // u16 / u32 fingerprints (array_len items)
+  size_t map_size; // > 0 if fingerprints are mmap'ed from file
+} fuse_t;
+
+INLINE u64 fuse_key(const u32 *h) {
+  // 160 bit hash to 64 bit key; keys are unique for any practical list of hashes
+  u64 a = (u64)h[0] << 32 | h[1], b = (u64)h[2] << 32 | h[3];
+  return a ^ b * 0x9e3779b97f4a7c15 ^ h[4];
+}
+
+INLINE u64 fuse_mix(u64 h) {
+  // murmur3 finalizer (bijective, so distinct keys give distinct hashes)
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccd;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53;
+  h ^= h >> 33;
+  return h;
+}
+
+INLINE u64 fuse_splitmix64(u64 *seed) {
+  u64 z = (*seed += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+INLINE void fuse_index(const fuse_t *f, u64 hash, u32 h[3]) {
+  h[0] = (u32)(((u128)hash * f->seg_count_len) >> 64);
+  h[1] = (h[0] + f->seg_len) ^ ((u32)(hash >> 18) & f->seg_mask);
+  h[2] = (h[0] + 2 * f->seg_len) ^ ((u32)hash & f->seg_mask);
+}
+
+INLINE u32 fuse_fp(const fuse_t *f, u64 hash) {
+  u32 fp = (u32)(hash ^ (hash >> 32));
+  return f->fp_bits == 16 ? (u16)fp : fp;
+}
+
+INLINE u32 fuse_get(const fuse_t *f, u32 i) {
+  return f->fp_bits == 16 ? ((const u16 *)f->fps)[i] : ((const u32 *)f->fps)[i];
+}
+
+INLINE void fuse_set(fuse_t *f, u32 i, u32 v) {
+  if (f->fp_bits == 16) ((u16 *)f->fps)[i] = (u16)v;
+  else ((u32 *)f->fps)[i] = v;
+}
+
+bool fuse_has(const fuse_t *f, const h160_t hash) {
+  u64 h = fuse_mix(fuse_key(hash) + f->seed);
+  u32 idx[3];
+  fuse_index(f, h, idx);
+  return (fuse_fp(f, h) ^ fuse_get(f, idx[0]) ^ fuse_get(f, idx[1]) ^ fuse_get(f, idx[2])) == 0;
+}
+
+void fuse_has_batch(const fuse_t *f, const h160x_t hashes, size_t n, u32 *out_mask) {
+  // same as blf_has_batch: all positions are computed & prefetched first, then tested
+  assert(n <= HASH_BATCH_SIZE && n <= 32);
+  u64 hs[HASH_BATCH_SIZE];
+  u32 idx[HASH_BATCH_SIZE][3];
+  u32 fpw = f->fp_bits / 8;
+
+  for (size_t i = 0; i < n; ++i) {
+    h160_t h;
+    h160x_get(h, hashes, i);
+    hs[i] = fuse_mix(fuse_key(h) + f->seed);
+    fuse_index(f, hs[i], idx[i]);
+    for (size_t j = 0; j < 3; ++j) __builtin_prefetch((const u8 *)f->fps + (size_t)idx[i][j] * fpw);
+  }
+
+  u32 mask = 0;
+  for (size_t i = 0; i < n; ++i) {
+    u32 x = fuse_fp(f, hs[i]) ^ fuse_get(f, idx[i][0]) ^ fuse_get(f, idx[i][1]);
+    mask |= (u32)((x ^ fuse_get(f, idx[i][2])) == 0) << i;
+  }
+
+  *out_mask = mask;
+}
+
+void fuse_free(fuse_t *f) {
+  if (f->map_size > 0) file_unmap((u8 *)f->fps - BLF_PAGE_SIZE, f->map_size);
+  else free(f->fps);
+  f->fps = NULL;
+}
+
+// MARK: construction
+
+int _fuse_cmp_u64(const void *a, const void *b) {
+  u64 x = *(const u64 *)a, y = *(const u64 *)b;
+  return x < y ? -1 : x > y;
+}
+
+void _fuse_params(fuse_t *f, u32 size) {
+  // sizes from reference implementation (binary_fuse*_allocate, arity 3)
+  u32 seg_len = (u32)1 << (int)floor(log((double)size) / log(3.33) + 2.25);
+  seg_len = MIN(seg_len, 262144u);
+
+  double size_factor = MAX(1.125, 0.875 + 0.25 * log(1000000.0) / log((double)size));
+  u32 capacity = (u32)round((double)size * size_factor);
+  u32 init_seg_count = (capacity + seg_len - 1) / seg_len - 2;
+  u32 array_len = (init_seg_count + 2) * seg_len;
+  u32 seg_count = (array_len + seg_len - 1) / seg_len;
+  seg_count = seg_count <= 2 ? 1 : seg_count - 2;
+
+  f->seg_len = seg_len;
+  f->seg_mask = seg_len - 1;
+  f->seg_count_len = seg_count * seg_len;
+  f->array_len = (seg_count + 2) * seg_len;
+}
+
+// build filter from unique keys (fuse_key of hashes), false if construction failed
+bool fuse_build(fuse_t *f, const u64 *keys, u32 size, u32 fp_bits) {
+  assert(size >= 2 && (fp_bits == 16 || fp_bits == 32));
+  _fuse_params(f, size);
+  f->fp_bits = fp_bits;
+  f->map_size = 0;
+  f->fps = calloc(f->array_len, fp_bits / 8);
+
+  u32 capacity = f->array_len;
+  u64 *order = calloc(size + 1, sizeof(u64)); // key hashes, later: peeling order
+  u8 *order_h = malloc(size);                 // which of 3 positions is set by key
+  u32 *alone = malloc(capacity * sizeof(u32));
+  u8 *t2count = calloc(capacity, 1); // keys in slot << 2 | xor of positions of them
+  u64 *t2hash = calloc(capacity, sizeof(u64));
+
+  u32 block_bits = 1;
+  while (((u32)1 << block_bits) < f->seg_count_len / f->seg_len) block_bits += 1;
+  u32 block = (u32)1 << block_bits;
+  u32 *start_pos = malloc(block * sizeof(u32));
+
+  u64 rng = 0x726b2b9d438b9d4d;
+  f->seed = fuse_splitmix64(&rng);
+  order[size] = 1;
+
+  bool ok = false;
+  for (int loop = 0; loop < FUSE_MAX_ITERATIONS && !ok; ++loop) {
+    if (loop > 0) {
+      memset(order, 0, sizeof(u64) * size);
+      memset(t2count, 0, capacity);
+      memset(t2hash, 0, sizeof(u64) * capacity);
+      f->seed = fuse_splitmix64(&rng);
+    }
+
+    // keys are placed in order of their segment, so updates of t2* below are mostly local
+    for (u32 i = 0; i < block; ++i) start_pos[i] = ((u64)i * size) >> block_bits;
+    for (u32 i = 0; i < size; ++i) {
+      u64 hash = fuse_mix(keys[i] + f->seed);
+      u64 seg = hash >> (64 - block_bits);
+      while (order[start_pos[seg]] != 0) seg = (seg + 1) & (block - 1);
+      order[start_pos[seg]++] = hash;
+    }
+
+    bool error = false;
+    for (u32 i = 0; i < size; ++i) {
+      u64 hash = order[i];
+      u32 h[3];
+      fuse_index(f, hash, h);
+      for (u32 j = 0; j < 3; ++j) {
+        t2count[h[j]] += 4;
+        t2count[h[j]] ^= j;
+        t2hash[h[j]] ^= hash;
+        error = error || t2count[h[j]] < 4; // counter overflow
+      }
+    }
+    if (error) continue;
+
+    // peeling: take slots with single key, remove this key from its other two slots
+    u32 qsize = 0, stack_size = 0;
+    for (u32 i = 0; i < capacity; ++i) {
+      alone[qsize] = i;
+      qsize += (t2count[i] >> 2) == 1;
+    }
+
+    while (qsize > 0) {
+      u32 index = alone[--qsize];
+      if ((t2count[index] >> 2) != 1) continue;
+
+      u64 hash = t2hash[index];
+      u32 h[3];
+      fuse_index(f, hash, h);
+      u8 found = t2count[index] & 3;
+      order_h[stack_size] = found;
+      order[stack_size] = hash;
+      stack_size += 1;
+
+      for (u32 k = 1; k <= 2; ++k) {
+        u32 j = (found + k) % 3, other = h[j];
+        alone[qsize] = other;
+        qsize += (t2count[other] >> 2) == 2;
+        t2count[other] -= 4;
+        t2count[other] ^= j;
+        t2hash[other] ^= hash;
+      }
+    }
+
+    ok = stack_size == size;
+  }
+
+  // assign fingerprints in reverse peeling order: slot of key is the last free one of its three
+  for (u32 i = size; ok && i-- > 0;) {
+    u64 hash = order[i];
+    u32 h[3];
+    fuse_index(f, hash, h);
+    u8 found = order_h[i];
+    u32 fp = fuse_fp(f, hash) ^ fuse_get(f, h[(found + 1) % 3]) ^ fuse_get(f, h[(found + 2) % 3]);
+    fuse_set(f, h[found], fp);
+  }
+
+  free(order);
+  free(order_h);
+  free(alone);
+  free(t2count);
+  free(t2hash);
+  free(start_pos);
+  return ok;
+}
+
+// MARK: save / load
+
+// header: magic, version, fp_bits, seg_len, seg_count_len, array_len, seed; zero padded to page
+
+bool fuse_save(const char *filepath, const fuse_t *f) {
+  FILE *file = fopen(filepath, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "failed to open output file\n");
+    return false;
+  }
+
+  u8 header[BLF_PAGE_SIZE] = {0};
+  u32 fields[6] = {FUSE_MAGIC, FUSE_VERSION, f->fp_bits, f->seg_len, f->seg_count_len,
+                   f->array_len};
+  memcpy(header, fields, sizeof(fields));
+  memcpy(header + sizeof(fields), &f->seed, sizeof(f->seed));
+
+  size_t fpw = f->fp_bits / 8;
+  bool is_ok = fwrite(header, sizeof(header), 1, file) == 1;
+  is_ok = is_ok && fwrite(f->fps, fpw, f->array_len, file) == f->array_len;
+  fclose(file);
+
+  if (!is_ok) fprintf(stderr, "failed to write fuse filter\n");
+  return is_ok;
+}
+
+bool fuse_load(const char *filepath, fuse_t *f, bool populate) {
+  FILE *file = fopen(filepath, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "failed to open input file\n");
+    return false;
+  }
+
+  u32 fields[6];
+  bool is_ok = fread(fields, sizeof(fields), 1, file) == 1;
+  is_ok = is_ok && fread(&f->seed, sizeof(f->seed), 1, file) == 1;
+  is_ok = is_ok && fields[0] == FUSE_MAGIC && fields[1] == FUSE_VERSION;
+  is_ok = is_ok && (fields[2] == 16 || fields[2] == 32);
+  is_ok = is_ok && fields[3] > 0 && (fields[3] & (fields[3] - 1)) == 0;
+  is_ok = is_ok && fields[4] % fields[3] == 0 && fields[5] == fields[4] + 2 * fields[3];
+  if (!is_ok) {
+    fprintf(stderr, "invalid fuse filter file; create a new one with fuse-gen command\n");
+    fclose(file);
+    return false;
+  }
+
+  f->fp_bits = fields[2];
+  f->seg_len = fields[3];
+  f->seg_mask = fields[3] - 1;
+  f->seg_count_len = fields[4];
+  f->array_len = fields[5];
+
+  size_t fpw = f->fp_bits / 8, size = BLF_PAGE_SIZE + f->array_len * fpw;
+  void *ptr = file_map(file, size, populate);
+  if (ptr != NULL) {
+    fclose(file);
+    f->fps = (u8 *)ptr + BLF_PAGE_SIZE;
+    f->map_size = size;
+    return true;
+  }
+
+  f->map_size = 0;
+  f->fps = malloc(f->array_len * fpw);
+  is_ok = fseek(file, BLF_PAGE_SIZE, SEEK_SET) == 0;
+  is_ok = is_ok && fread(f->fps, fpw, f->array_len, file) == f->array_len;
+  fclose(file);
+
+  if (!is_ok) fprintf(stderr, "failed to read fuse filter\n");
+  return is_ok;
+}
+
+// MARK: fuse-gen command
+
+void __fuse_gen_usage(args_t *args) {
+  printf("Usage: %s fuse-gen -o <file> [-bits <16|32>]\n", args->argv[0]);
+  printf("Build a binary fuse filter from a list of hex-encoded hash160 values passed to stdin.\n");
+  printf("\nOptions:\n");
+  printf("  -o <file>       - File to write filter to.\n");
+  printf("  -bits <n>       - Fingerprint size: 32 (default, p ~ 2.3e-10) or 16 (p ~ 1.5e-5).\n");
+  exit(1);
+}
+
+void fuse_gen(args_t *args) {
+  char *filepath = arg_str(args, "-o");
+  if (filepath == NULL) {
+    fprintf(stderr, "[!] missing output file (-o <file>)\n");
+    return __fuse_gen_usage(args);
+  }
+
+  u32 fp_bits = args_uint(args, "-bits", 32);
+  if (fp_bits != 16 && fp_bits != 32) {
+    fprintf(stderr, "[!] invalid fingerprint size: %u\n", fp_bits);
+    return __fuse_gen_usage(args);
+  }
+
+  size_t stime = tsnow(), lines = 0;
+  h160_t *hashes = NULL;
+  size_t count = h160_load(stdin, &hashes, &lines);
+
+  u64 *keys = malloc(MAX(count, 1ul) * sizeof(u64));
+  for (size_t i = 0; i < count; ++i) keys[i] = fuse_key(hashes[i]);
+  free(hashes);
+
+  qsort(keys, count, sizeof(u64), _fuse_cmp_u64);
+  size_t size = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (size == 0 || keys[i] != keys[size - 1]) keys[size++] = keys[i];
+  }
+
+  printf("read %'zu lines, %'zu unique hashes\n", lines, size);
+  if (size < 2 || size >= UINT32_MAX / 2) {
+    fprintf(stderr, "[!] number of hashes should be in range 2..2^31\n");
+    exit(1);
+  }
+
+  fuse_t f;
+  if (!fuse_build(&f, keys, size, fp_bits)) {
+    fprintf(stderr, "[!] failed to build fuse filter\n");
+    exit(1);
+  }
+  free(keys);
+
+  double mb = (double)f.array_len * fp_bits / 8 / 1024 / 1024;
+  double dt = MAX(tsnow() - stime, 1ul) / 1000.0;
+  printf("fuse filter: %u-bit fingerprints | %.2f bits per hash | %'.1f MB | built in %.2fs\n",
+         fp_bits, (double)f.array_len * fp_bits / size, mb, dt);
+
+  if (!fuse_save(filepath, &f)) {
+    fprintf(stderr, "[!] failed to save fuse filter\n");
+    exit(1);
+  }
+
+  printf("saved to %s\n", filepath);
+  fuse_free(&f);
+}
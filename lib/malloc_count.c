@@ -0,0 +1,54 @@
+// Copyright (c) vladkens
+// https://github.com/vladkens/ecloop
+// Licensed under the MIT License.
+
+// LD_PRELOAD shim for `make alloc-verify` (glibc only, not part of ecloop build): counts heap
+// allocations of the process and writes total to file from MALLOC_COUNT_OUT on exit
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t align, size_t size);
+
+static _Atomic size_t allocs = 0;
+
+void *malloc(size_t size) {
+  atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+  atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+  return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+  return __libc_realloc(ptr, size);
+}
+
+void *aligned_alloc(size_t align, size_t size) {
+  atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+  return __libc_memalign(align, size);
+}
+
+int posix_memalign(void **ptr, size_t align, size_t size) {
+  atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+  *ptr = __libc_memalign(align, size);
+  return *ptr == NULL ? 12 : 0; // ENOMEM
+}
+
+__attribute__((destructor)) static void malloc_count_dump(void) {
+  const char *path = getenv("MALLOC_COUNT_OUT");
+  if (path == NULL) return;
+
+  size_t count = atomic_load(&allocs);
+  FILE *file = fopen(path, "w"); // counted too, but after the value is taken
+  if (file == NULL) return;
+  fprintf(file, "%zu\n", count);
+  fclose(file);
+}
@@ -25,12 +25,7 @@
 
   #define RMD_SWAP(x) vreinterpretq_u32_u8(vrev32q_u8(vreinterpretq_u8_u32(x)))
   #define RMD_LOAD(x, i) vld1q_u32(((uint32_t[4]){x[0][i], x[1][i], x[2][i], x[3][i]}))
-  #define RMD_DUMP(r, s, i)                                                                        \
-    do {                                                                                           \
-      alignas(16) uint32_t tmp[4];                                                                 \
-      vst1q_u32(tmp, s[i]);                                                                        \
-      for (int j = 0; j < 4; ++j) r[j][i] = tmp[j];                                                \
-    } while (0);
+  #define RMD_STORE(p, x) vst1q_u32(p, x)
 
   #define RMD_F1(x, y, z) veorq_u32(veorq_u32(x, y), z)
   #define RMD_F2(x, y, z) vbslq_u32(x, y, z)
@@ -43,6 +38,34 @@
   #define RMD_ADD3(a, b, c) vaddq_u32(vaddq_u32(a, b), c)
   #define RMD_ADD4(a, b, c, d) vaddq_u32(vaddq_u32(vaddq_u32(a, b), c), d)
 
+#elif defined(__x86_64__) && defined(__AVX512F__) && defined(__AVX512BW__) && !defined(NO_SIMD)
+  #include <immintrin.h>
+
+  #define RMD_LEN 16
+  #define RMD_VEC __m512i
+  #define RMD_LD_NUM(x) _mm512_set1_epi32(x)
+
+  #define RMD_SWAP(x)                                                                              \
+    _mm512_shuffle_epi8((x), _mm512_set4_epi32(0x0c0d0e0f, 0x08090a0b, 0x04050607, 0x00010203))
+
+  #define RMD_LOAD(x, i)                                                                           \
+    _mm512_set_epi32(x[15][i], x[14][i], x[13][i], x[12][i], x[11][i], x[10][i], x[9][i], x[8][i], \
+                     x[7][i], x[6][i], x[5][i], x[4][i], x[3][i], x[2][i], x[1][i], x[0][i])
+
+  #define RMD_STORE(p, x) _mm512_storeu_si512((void *)(p), x)
+
+  // ternary logic immediates are truth tables of f(x, y, z) for x = 0xf0, y = 0xcc, z = 0xaa
+  #define RMD_F1(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x96)
+  #define RMD_F2(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xca)
+  #define RMD_F3(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x59)
+  #define RMD_F4(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xe4)
+  #define RMD_F5(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x2d)
+
+  #define RMD_ROTL(x, n) _mm512_rol_epi32(x, n)
+  #define RMD_ADD2(a, b) _mm512_add_epi32(a, b)
+  #define RMD_ADD3(a, b, c) _mm512_add_epi32(_mm512_add_epi32(a, b), c)
+  #define RMD_ADD4(a, b, c, d) _mm512_add_epi32(_mm512_add_epi32(a, b), _mm512_add_epi32(c, d))
+
 #elif defined(__x86_64__) && defined(__AVX2__) && !defined(NO_SIMD)
   #include <immintrin.h>
 
@@ -58,12 +81,7 @@
   #define RMD_LOAD(x, i)                                                                           \
     _mm256_set_epi32(x[7][i], x[6][i], x[5][i], x[4][i], x[3][i], x[2][i], x[1][i], x[0][i])
 
-  #define RMD_DUMP(r, s, i)                                                                        \
-    do {                                                                                           \
-      alignas(32) int32_t tmp[8];                                                                  \
-      _mm256_store_si256((__m256i *)tmp, s[i]);                                                    \
-      for (int j = 0; j < 8; ++j) r[j][i] = tmp[j];                                                \
-    } while (0);
+  #define RMD_STORE(p, x) _mm256_storeu_si256((__m256i *)(p), x)
 
   #define _mm256_not_si256(x) _mm256_xor_si256((x), _mm256_set1_epi32(0xffffffff))
   #define RMD_F1(x, y, z) _mm256_xor_si256(x, _mm256_xor_si256(y, z))
@@ -86,7 +104,7 @@
 
   #define RMD_SWAP(x) __builtin_bswap32(x)
   #define RMD_LOAD(x, i) x[0][i]
-  #define RMD_DUMP(r, s, i) r[0][i] = s[i]
+  #define RMD_STORE(p, x) *(p) = x
 
   #define RMD_F1(x, y, z) ((x) ^ (y) ^ (z))
   #define RMD_F2(x, y, z) (((x) & (y)) | (~(x) & (z)))
@@ -119,35 +137,13 @@
 
 #define RMD_LOAD_SWAP(x, i) RMD_SWAP(RMD_LOAD(x, i))
 
-void rmd160_block(RMD_VEC *s, const uint32_t x[RMD_LEN][16]) {
+void rmd160_block(RMD_VEC *s, const RMD_VEC w[16]) {
   RMD_VEC a1, b1, c1, d1, e1, a2, b2, c2, d2, e2, u;
-  a1 = a2 = RMD_LD_NUM(RMD_K1);
-  b1 = b2 = RMD_LD_NUM(RMD_K2);
-  c1 = c2 = RMD_LD_NUM(RMD_K3);
-  d1 = d2 = RMD_LD_NUM(RMD_K4);
-  e1 = e2 = RMD_LD_NUM(RMD_K5);
-
-  RMD_VEC w[16];
-  // for (int i = 0; i < 16; i++) w[i] = RMD_LOAD(x, i);
-
-  // SHA256 is big-endian, but RIPEMD-160 is little-endian, so swap bytes here
-  // keep unrolled let ILP decide how to schedule
-  w[0] = RMD_LOAD_SWAP(x, 0);
-  w[1] = RMD_LOAD_SWAP(x, 1);
-  w[2] = RMD_LOAD_SWAP(x, 2);
-  w[3] = RMD_LOAD_SWAP(x, 3);
-  w[4] = RMD_LOAD_SWAP(x, 4);
-  w[5] = RMD_LOAD_SWAP(x, 5);
-  w[6] = RMD_LOAD_SWAP(x, 6);
-  w[7] = RMD_LOAD_SWAP(x, 7);
-  w[8] = RMD_LOAD_SWAP(x, 8);
-  w[9] = RMD_LOAD_SWAP(x, 9);
-  w[10] = RMD_LOAD_SWAP(x, 10);
-  w[11] = RMD_LOAD_SWAP(x, 11);
-  w[12] = RMD_LOAD_SWAP(x, 12);
-  w[13] = RMD_LOAD_SWAP(x, 13);
-  w[14] = RMD_LOAD_SWAP(x, 14);
-  w[15] = RMD_LOAD_SWAP(x, 15);
+  a1 = a2 = s[0];
+  b1 = b2 = s[1];
+  c1 = c2 = s[2];
+  d1 = d2 = s[3];
+  e1 = e2 = s[4];
 
   RMD_L1(a1, b1, c1, d1, e1, w[0], 11);
   RMD_R1(a2, b2, c2, d2, e2, w[5], 8);
@@ -322,15 +318,25 @@ void rmd160_block(RMD_VEC *s, const uint32_t x[RMD_LEN][16]) {
   s[4] = RMD_ADD3(t, b1, c2);
 }
 
-void rmd160_batch(uint32_t r[RMD_LEN][5], const uint32_t x[RMD_LEN][16]) {
-  RMD_VEC s[5] = {0}; // load initial state
-  s[0] = RMD_LD_NUM(RMD_K1);
-  s[1] = RMD_LD_NUM(RMD_K2);
-  s[2] = RMD_LD_NUM(RMD_K3);
-  s[3] = RMD_LD_NUM(RMD_K4);
-  s[4] = RMD_LD_NUM(RMD_K5);
-
-  rmd160_block((RMD_VEC *)s, x);                     // round
-  for (int i = 0; i < 5; ++i) s[i] = RMD_SWAP(s[i]); // change endian
-  for (int i = 0; i < 5; ++i) RMD_DUMP(r, s, i);     // dump data to array
+// one block message already in lanes (w[i] is word i of every message, little-endian);
+// writes digest words in the same layout, ready to compare against hash160 words
+void rmd160_final_x(RMD_VEC r[5], const RMD_VEC w[16]) {
+  r[0] = RMD_LD_NUM(RMD_K1);
+  r[1] = RMD_LD_NUM(RMD_K2);
+  r[2] = RMD_LD_NUM(RMD_K3);
+  r[3] = RMD_LD_NUM(RMD_K4);
+  r[4] = RMD_LD_NUM(RMD_K5);
+
+  rmd160_block(r, w);                                // round
+  for (int i = 0; i < 5; ++i) r[i] = RMD_SWAP(r[i]); // change endian
+}
+
+void rmd160_batch(uint32_t r[5][RMD_LEN], const uint32_t x[RMD_LEN][16]) {
+  RMD_VEC s[5], w[16];
+
+  // SHA256 is big-endian, but RIPEMD-160 is little-endian, so swap bytes here
+  for (int i = 0; i < 16; ++i) w[i] = RMD_LOAD_SWAP(x, i);
+
+  rmd160_final_x(s, w);
+  for (int i = 0; i < 5; ++i) RMD_STORE(r[i], s[i]); // dump data to array
 }
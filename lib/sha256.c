@@ -196,6 +196,11 @@ void sha256_final(u32 state[8], const u8 data[], u32 length) {
   __m128i MSG, TMP;
   __m128i MSG0, MSG1, MSG2, MSG3;
   __m128i ABEF_SAVE, CDGH_SAVE;
+  #ifdef __AVX__
+  // sha256rnds2 & co have no VEX encoding, clear dirty upper ymm/zmm state left by the
+  // vectorized callers, otherwise every legacy SSE op here pays a transition penalty
+  _mm256_zeroupper();
+  #endif
   const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
 
   /* Load initial values */
@@ -0,0 +1,104 @@
+// Copyright (c) vladkens
+// https://github.com/vladkens/ecloop
+// Licensed under the MIT License.
+
+#pragma once
+#include "rmd160s.c"
+#include "sha256.c"
+
+// Multi-lane SHA-256: RMD_LEN independent messages at once, on the same vector type as
+// rmd160s.c, so the digest can be passed to RIPEMD-160 in the same lane layout.
+// Word i of every lane is kept in one vector: w[i] = {msg0[i], msg1[i], ...}.
+
+#if RMD_LEN == 16
+  #define SHA_SHR(x, n) _mm512_srli_epi32(x, n)
+  #define SHA_XOR(a, b) _mm512_xor_si512(a, b)
+  #define SHA_MAJ(a, b, c) _mm512_ternarylogic_epi32(a, b, c, 0xe8)
+  #define SHA_LOAD(p) _mm512_load_si512((const __m512i *)(p))
+#elif RMD_LEN == 8
+  #define SHA_SHR(x, n) _mm256_srli_epi32(x, n)
+  #define SHA_XOR(a, b) _mm256_xor_si256(a, b)
+  #define SHA_LOAD(p) _mm256_load_si256((const __m256i *)(p))
+#elif RMD_LEN == 4
+  #define SHA_SHR(x, n) vshrq_n_u32(x, n)
+  #define SHA_XOR(a, b) veorq_u32(a, b)
+  #define SHA_LOAD(p) vld1q_u32(p)
+#else
+  #define SHA_SHR(x, n) ((x) >> (n))
+  #define SHA_XOR(a, b) ((a) ^ (b))
+  #define SHA_LOAD(p) (*(p))
+#endif
+
+#ifndef SHA_MAJ
+  // maj(a, b, c) = ch(a ^ b, c, b)
+  #define SHA_MAJ(a, b, c) RMD_F2(SHA_XOR(a, b), c, b)
+#endif
+
+#define SHA_ROTR(x, n) RMD_ROTL(x, 32 - (n))
+#define SHA_CH(e, f, g) RMD_F2(e, f, g)
+#define SHA_S0(x) RMD_F1(SHA_ROTR(x, 2), SHA_ROTR(x, 13), SHA_ROTR(x, 22))
+#define SHA_S1(x) RMD_F1(SHA_ROTR(x, 6), SHA_ROTR(x, 11), SHA_ROTR(x, 25))
+#define SHA_G0(x) RMD_F1(SHA_ROTR(x, 7), SHA_ROTR(x, 18), SHA_SHR(x, 3))
+#define SHA_G1(x) RMD_F1(SHA_ROTR(x, 17), SHA_ROTR(x, 19), SHA_SHR(x, 10))
+
+#define SHA_RN(a, b, c, d, e, f, g, h, i)                                                          \
+  t = RMD_ADD4(h, SHA_S1(e), SHA_CH(e, f, g), RMD_ADD2(w[(i) & 15], RMD_LD_NUM(SHA256_K[i])));     \
+  d = RMD_ADD2(d, t);                                                                              \
+  h = RMD_ADD3(t, SHA_S0(a), SHA_MAJ(a, b, c));
+
+#define SHA_WN(i)                                                                                  \
+  w[(i) & 15] = RMD_ADD4(w[(i) & 15], SHA_G0(w[((i) + 1) & 15]), w[((i) + 9) & 15],               \
+                         SHA_G1(w[((i) + 14) & 15]));
+
+void sha256_init_x(RMD_VEC s[8]) {
+  for (int i = 0; i < 8; ++i) s[i] = RMD_LD_NUM(SHA256_IV[i]);
+}
+
+// compress one 64 byte block, `w` is used as message schedule and overwritten
+void sha256_block_x(RMD_VEC s[8], RMD_VEC w[16]) {
+  RMD_VEC a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7], t;
+
+  for (int i = 0; i < 64; i += 8) {
+    if (i >= 16) {
+      SHA_WN(i + 0);
+      SHA_WN(i + 1);
+      SHA_WN(i + 2);
+      SHA_WN(i + 3);
+      SHA_WN(i + 4);
+      SHA_WN(i + 5);
+      SHA_WN(i + 6);
+      SHA_WN(i + 7);
+    }
+
+    SHA_RN(a, b, c, d, e, f, g, h, i + 0);
+    SHA_RN(h, a, b, c, d, e, f, g, i + 1);
+    SHA_RN(g, h, a, b, c, d, e, f, i + 2);
+    SHA_RN(f, g, h, a, b, c, d, e, i + 3);
+    SHA_RN(e, f, g, h, a, b, c, d, i + 4);
+    SHA_RN(d, e, f, g, h, a, b, c, i + 5);
+    SHA_RN(c, d, e, f, g, h, a, b, i + 6);
+    SHA_RN(b, c, d, e, f, g, h, a, i + 7);
+  }
+
+  s[0] = RMD_ADD2(s[0], a);
+  s[1] = RMD_ADD2(s[1], b);
+  s[2] = RMD_ADD2(s[2], c);
+  s[3] = RMD_ADD2(s[3], d);
+  s[4] = RMD_ADD2(s[4], e);
+  s[5] = RMD_ADD2(s[5], f);
+  s[6] = RMD_ADD2(s[6], g);
+  s[7] = RMD_ADD2(s[7], h);
+}
+
+// MARK: hash160
+
+// rmd160(sha256(msg)) tail: sha256 state goes to rmd160 rounds in the same registers, so no
+// transpose between the two (digest words per lane, same as rmd160_final_x output)
+void hash160_x(RMD_VEC r[5], const RMD_VEC s[8]) {
+  RMD_VEC w[16];
+  for (int i = 0; i < 8; ++i) w[i] = RMD_SWAP(s[i]); // sha256 digest is big-endian
+  w[8] = RMD_LD_NUM(0x80);
+  for (int i = 9; i < 16; ++i) w[i] = RMD_LD_NUM(0);
+  w[14] = RMD_LD_NUM(256);
+  rmd160_final_x(r, w);
+}
@@ -4,10 +4,13 @@
 
 #pragma once
 
+#include "addr.c"
 #include "ecc.c"
 #include <assert.h>
 #include <math.h>
 #include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -20,9 +23,20 @@
   #include <windows.h>
 #else
   #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
   #include <termios.h>
 #endif
 
+#if defined(__SSSE3__) && !defined(NO_SIMD)
+  #include <tmmintrin.h>
+#endif
+
+#ifdef __linux__
+  #include <linux/futex.h>
+  #include <sys/syscall.h>
+#endif
+
 typedef char hex40[41]; // rmd160 hex string
 typedef char hex64[65]; // sha256 hex string
 typedef u32 h160_t[5];
@@ -186,108 +200,605 @@ char *arg_str(args_t *args, const char *name) {
 
 // MARK: queue
 
-typedef struct queue_item_t {
+// bounded MPMC ring buffer (dvyukov's): each slot has sequence number, which tells if it is free
+// for put (seq == pos) or holds value for get (seq == pos + 1); threads block only when queue is
+// empty / full, on futex over event counter (other platforms poll with short sleep)
+
+typedef struct queue_slot_t {
+  _Atomic size_t seq;
   void *data_ptr;
-  struct queue_item_t *next;
-} queue_item_t;
+} queue_slot_t;
 
 typedef struct queue_t {
-  size_t capacity;
-  size_t size;
-  bool done;
-  queue_item_t *head;
-  queue_item_t *tail;
-  pthread_mutex_t lock;
-  pthread_cond_t cond_put;
-  pthread_cond_t cond_get;
+  size_t capacity; // power of two
+  queue_slot_t *slots;
+  alignas(64) _Atomic size_t head; // next position to put
+  alignas(64) _Atomic size_t tail; // next position to get
+  alignas(64) _Atomic u32 puts;    // event counters, changed on put / get (futex words)
+  _Atomic u32 gets;
+  _Atomic u32 put_waiters; // threads sleeping on full queue
+  _Atomic u32 get_waiters; // threads sleeping on empty queue
+  _Atomic bool done;
 } queue_t;
 
+static void _queue_wait(_Atomic u32 *addr, u32 val) {
+  // sleeps while *addr == val, spurious wakeups are fine
+#ifdef __linux__
+  syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+  if (atomic_load(addr) == val) usleep(100);
+#endif
+}
+
+static void _queue_wake(_Atomic u32 *addr, int count) {
+#ifdef __linux__
+  syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+#else
+  (void)addr, (void)count;
+#endif
+}
+
 void queue_init(queue_t *q, size_t capacity) {
-  q->capacity = capacity;
-  q->size = 0;
-  q->done = false;
-  q->head = NULL;
-  q->tail = NULL;
-  pthread_mutex_init(&q->lock, NULL);
-  pthread_cond_init(&q->cond_put, NULL);
-  pthread_cond_init(&q->cond_get, NULL);
+  q->capacity = 2;
+  while (q->capacity < capacity) q->capacity <<= 1;
+
+  q->slots = malloc(q->capacity * sizeof(queue_slot_t));
+  for (size_t i = 0; i < q->capacity; ++i) atomic_init(&q->slots[i].seq, i);
+
+  atomic_init(&q->head, 0);
+  atomic_init(&q->tail, 0);
+  atomic_init(&q->puts, 0);
+  atomic_init(&q->gets, 0);
+  atomic_init(&q->put_waiters, 0);
+  atomic_init(&q->get_waiters, 0);
+  atomic_init(&q->done, false);
+}
+
+void queue_free(queue_t *q) {
+  free(q->slots);
+  q->slots = NULL;
+}
+
+bool queue_try_put(queue_t *q, void *data_ptr) {
+  size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+  while (true) {
+    queue_slot_t *slot = &q->slots[pos & (q->capacity - 1)];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+    if (dif < 0) return false; // slot still holds value from previous round: full
+    if (dif > 0) {
+      pos = atomic_load_explicit(&q->head, memory_order_relaxed); // taken by other thread
+      continue;
+    }
+
+    if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1, memory_order_relaxed,
+                                              memory_order_relaxed)) {
+      slot->data_ptr = data_ptr;
+      atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+      return true;
+    }
+  }
+}
+
+bool queue_try_get(queue_t *q, void **data_ptr) {
+  size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+  while (true) {
+    queue_slot_t *slot = &q->slots[pos & (q->capacity - 1)];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+
+    if (dif < 0) return false; // slot not filled yet: empty
+    if (dif > 0) {
+      pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+      continue;
+    }
+
+    if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1, memory_order_relaxed,
+                                              memory_order_relaxed)) {
+      *data_ptr = slot->data_ptr;
+      atomic_store_explicit(&slot->seq, pos + q->capacity, memory_order_release);
+      return true;
+    }
+  }
 }
 
 void queue_done(queue_t *q) {
-  pthread_mutex_lock(&q->lock);
-  q->done = true;
-  pthread_cond_broadcast(&q->cond_get);
-  pthread_mutex_unlock(&q->lock);
+  atomic_store(&q->done, true);
+  atomic_fetch_add(&q->puts, 1);
+  _queue_wake(&q->puts, INT32_MAX);
 }
 
 void queue_put(queue_t *q, void *data_ptr) {
-  pthread_mutex_lock(&q->lock);
-  if (q->done) {
-    pthread_mutex_unlock(&q->lock);
-    return;
+  // waiter first registers itself, then checks queue again, so wakeup can't be lost: either
+  // other side sees it as waiter, or it sees changes made by other side (counter or slot)
+  while (!atomic_load(&q->done)) {
+    if (queue_try_put(q, data_ptr)) {
+      atomic_fetch_add(&q->puts, 1);
+      if (atomic_load(&q->get_waiters)) _queue_wake(&q->puts, 1);
+      return;
+    }
+
+    u32 ev = atomic_load(&q->gets);
+    atomic_fetch_add(&q->put_waiters, 1);
+    size_t head = atomic_load(&q->head), tail = atomic_load(&q->tail);
+    if (head - tail >= q->capacity) _queue_wait(&q->gets, ev);
+    atomic_fetch_sub(&q->put_waiters, 1);
   }
+}
+
+void *queue_get(queue_t *q) {
+  // returns NULL when queue is empty and done
+  void *data_ptr = NULL;
+  while (true) {
+    if (queue_try_get(q, &data_ptr)) {
+      atomic_fetch_add(&q->gets, 1);
+      if (atomic_load(&q->put_waiters)) _queue_wake(&q->gets, 1);
+      return data_ptr;
+    }
 
-  while (q->size == q->capacity) {
-    pthread_cond_wait(&q->cond_put, &q->lock);
+    u32 ev = atomic_load(&q->puts);
+    atomic_fetch_add(&q->get_waiters, 1);
+    bool is_empty = atomic_load(&q->head) == atomic_load(&q->tail);
+    bool is_done = atomic_load(&q->done);
+    if (is_empty && !is_done) _queue_wait(&q->puts, ev);
+    atomic_fetch_sub(&q->get_waiters, 1);
+    if (is_empty && is_done) return NULL;
   }
+}
+
+// MARK: CPU count
+
+int get_cpu_count() {
+#ifdef _WIN32
+  SYSTEM_INFO sysinfo;
+  GetSystemInfo(&sysinfo);
+  return (int)sysinfo.dwNumberOfProcessors;
+#else
+  int cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+  return MAX(1, cpu_count);
+#endif
+}
+
+// MARK: file mapping
 
-  queue_item_t *item = malloc(sizeof(queue_item_t));
-  item->data_ptr = data_ptr;
-  item->next = NULL;
+// maps first `size` bytes of file read-only & shared; NULL if not supported or failed
+void *file_map(FILE *file, size_t size, bool populate) {
+#ifdef _WIN32
+  (void)file, (void)size, (void)populate;
+  return NULL;
+#else
+  struct stat st;
+  if (fstat(fileno(file), &st) != 0 || (size_t)st.st_size < size) return NULL;
+
+  int flags = MAP_SHARED;
+  #ifdef MAP_POPULATE
+  if (populate) flags |= MAP_POPULATE; // fault all pages now, not on first probes
+  #endif
+
+  void *ptr = MAP_FAILED;
+  #ifdef MAP_HUGETLB
+  ptr = mmap(NULL, size, PROT_READ, flags | MAP_HUGETLB, fileno(file), 0); // hugetlbfs only
+  #endif
+  if (ptr == MAP_FAILED) ptr = mmap(NULL, size, PROT_READ, flags, fileno(file), 0);
+  if (ptr == MAP_FAILED) return NULL;
+
+  #ifdef MADV_HUGEPAGE
+  madvise(ptr, size, MADV_HUGEPAGE); // best effort, fewer TLB misses if kernel supports it
+  #endif
+
+  return ptr;
+#endif
+}
 
-  if (q->tail != NULL) q->tail->next = item;
-  else q->head = item;
+void file_unmap(void *ptr, size_t size) {
+#ifndef _WIN32
+  munmap(ptr, size);
+#else
+  (void)ptr, (void)size;
+#endif
+}
 
-  q->tail = item;
-  q->size += 1;
+// MARK: hash list loader
+
+// hash lists (one hex-encoded hash160 per line) are read in big chunks with read(2) and chunks
+// are parsed by several threads; used by load_filter, blf-gen & blf-check
+
+#define H160_CHUNK_SIZE (32 * 1024 * 1024)
+#define H160_CHUNK_MAX (H160_CHUNK_SIZE / 41 + 1) // max hashes in one chunk (40 hex + \n)
+
+// hex digit value | 0x10, zero for other chars
+static const u8 HEX_LUT[256] = {
+    ['0'] = 0x10, ['1'] = 0x11, ['2'] = 0x12, ['3'] = 0x13, ['4'] = 0x14, ['5'] = 0x15,
+    ['6'] = 0x16, ['7'] = 0x17, ['8'] = 0x18, ['9'] = 0x19, ['a'] = 0x1a, ['b'] = 0x1b,
+    ['c'] = 0x1c, ['d'] = 0x1d, ['e'] = 0x1e, ['f'] = 0x1f, ['A'] = 0x1a, ['B'] = 0x1b,
+    ['C'] = 0x1c, ['D'] = 0x1d, ['E'] = 0x1e, ['F'] = 0x1f,
+};
+
+// decode 40 hex chars, false if any of them is not a hex digit
+INLINE bool h160_from_hex(h160_t h, const char *s) {
+#if defined(__SSSE3__) && !defined(NO_SIMD)
+  // 16 chars -> 8 bytes per step; last step overlaps (chars 24..39), so no read past the hash
+  const __m128i nib = _mm_set1_epi16(0x0110); // maddubs: even byte * 16 + odd byte
+  u8 b[24];
+  int ok = 0xffff;
+  for (int i = 0; i < 3; ++i) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(s + (i == 2 ? 24 : i * 16)));
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i a = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_d = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    __m128i is_a = _mm_cmpeq_epi8(_mm_min_epu8(a, _mm_set1_epi8(5)), a);
+    ok &= _mm_movemask_epi8(_mm_or_si128(is_d, is_a));
+
+    a = _mm_add_epi8(a, _mm_set1_epi8(10));
+    v = _mm_or_si128(_mm_and_si128(is_d, d), _mm_andnot_si128(is_d, a));
+    v = _mm_packus_epi16(_mm_maddubs_epi16(v, nib), v);
+    _mm_storel_epi64((__m128i *)(b + i * 8), v);
+  }
 
-  pthread_cond_signal(&q->cond_get);
-  pthread_mutex_unlock(&q->lock);
+  u32 w[6];
+  memcpy(w, b, sizeof(w));
+  h[0] = swap32(w[0]), h[1] = swap32(w[1]), h[2] = swap32(w[2]);
+  h[3] = swap32(w[4]), h[4] = swap32(w[5]); // b[12..15] is not used, same as b[16..19]
+  return ok == 0xffff;
+#else
+  u8 ok = 0x10;
+  for (int i = 0; i < 5; ++i) {
+    u32 x = 0;
+    for (int j = 0; j < 8; ++j) {
+      u8 c = HEX_LUT[(u8)s[i * 8 + j]];
+      ok &= c;
+      x = x << 4 | (c & 0xf);
+    }
+    h[i] = x;
+  }
+  return ok != 0;
+#endif
 }
 
-void *queue_get(queue_t *q) {
-  pthread_mutex_lock(&q->lock);
-  while (q->size == 0 && !q->done) {
-    pthread_cond_wait(&q->cond_get, &q->lock);
+// parse lines in [s, e), lines with exactly 40 hex chars (surrounding spaces are ignored) go to
+// `out`, other lines are skipped; returns number of parsed hashes
+size_t _h160_parse(const char *s, const char *e, h160_t *out, size_t *lines) {
+  size_t n = 0, k = 0;
+  while (s < e) {
+    const char *le = memchr(s, '\n', e - s);
+    if (le == NULL) le = e;
+
+    const char *a = s, *b = le;
+    while (a < b && isspace((u8)*a)) ++a;
+    while (b > a && isspace((u8)b[-1])) --b;
+    if (b - a == 40 && h160_from_hex(out[n], a)) n += 1;
+
+    k += 1;
+    s = le + 1;
+  }
+
+  *lines = k;
+  return n;
+}
+
+typedef struct h160_reader_t {
+  int fd;
+  bool is_tty; // return after every read, so interactive input is not delayed
+  bool eof;
+  char *buf; // H160_CHUNK_SIZE bytes, starts with incomplete line from previous read
+  size_t len;
+  size_t lines; // total lines read
+  int threads;
+} h160_reader_t;
+
+void h160_reader_init(h160_reader_t *r, FILE *file) {
+  r->fd = fileno(file);
+  r->is_tty = isatty(r->fd);
+  r->eof = false;
+  r->buf = malloc(H160_CHUNK_SIZE);
+  r->len = 0;
+  r->lines = 0;
+  r->threads = get_cpu_count();
+}
+
+void h160_reader_free(h160_reader_t *r) {
+  free(r->buf);
+  r->buf = NULL;
+}
+
+typedef struct {
+  const char *s, *e;
+  h160_t *out;
+  size_t count, lines;
+} _h160_parse_job_t;
+
+void *_h160_parse_thread(void *arg) {
+  _h160_parse_job_t *job = arg;
+  job->count = _h160_parse(job->s, job->e, job->out, &job->lines);
+  return NULL;
+}
+
+size_t _h160_parse_mt(h160_reader_t *r, const char *s, const char *e, h160_t *out) {
+  // split by lines into parts (1MB+ each); part starting at byte `p` of chunk writes from
+  // out[p / 41], each parsed hash takes 41+ bytes, so parts do not overlap; then they are moved
+  // together
+  size_t len = e - s, parts = MIN((size_t)r->threads, len / (1 << 20) + 1);
+  parts = MIN(parts, 64ul);
+  if (parts == 1) {
+    size_t lines, n = _h160_parse(s, e, out, &lines);
+    r->lines += lines;
+    return n;
+  }
+
+  _h160_parse_job_t jobs[64];
+  pthread_t threads[64];
+  const char *p = s;
+  for (size_t i = 0; i < parts; ++i) {
+    const char *pe = i == parts - 1 ? e : s + len * (i + 1) / parts;
+    if (pe < p) pe = p;
+    while (pe < e && pe[-1] != '\n') ++pe; // part ends after newline
+
+    jobs[i] = (_h160_parse_job_t){.s = p, .e = pe, .out = out + (p - s) / 41};
+    pthread_create(&threads[i], NULL, _h160_parse_thread, &jobs[i]);
+    p = pe;
+  }
+
+  size_t n = 0;
+  for (size_t i = 0; i < parts; ++i) {
+    pthread_join(threads[i], NULL);
+    if (jobs[i].out != out + n) memmove(out + n, jobs[i].out, jobs[i].count * sizeof(h160_t));
+    n += jobs[i].count;
+    r->lines += jobs[i].lines;
+  }
+
+  return n;
+}
+
+// read & parse next chunk into `out` (H160_CHUNK_MAX items); returns 0 only at end of input
+size_t h160_read(h160_reader_t *r, h160_t *out) {
+  while (!r->eof || r->len > 0) {
+    while (!r->eof && r->len < H160_CHUNK_SIZE) {
+      ssize_t k = read(r->fd, r->buf + r->len, H160_CHUNK_SIZE - r->len);
+      if (k <= 0) {
+        r->eof = true;
+        break;
+      }
+
+      r->len += k;
+      if (r->is_tty && memchr(r->buf + r->len - k, '\n', k) != NULL) break;
+    }
+
+    // parse up to last newline (or everything at eof / if line does not fit to buffer)
+    size_t cut = r->len;
+    if (!r->eof) {
+      while (cut > 0 && r->buf[cut - 1] != '\n') --cut;
+      if (cut == 0 && r->len < H160_CHUNK_SIZE) continue;
+      if (cut == 0) cut = r->len;
+    }
+
+    size_t n = _h160_parse_mt(r, r->buf, r->buf + cut, out);
+    memmove(r->buf, r->buf + cut, r->len - cut);
+    r->len -= cut;
+    if (n > 0) return n;
   }
 
-  if (q->size == 0) {
-    pthread_mutex_unlock(&q->lock);
-    return NULL;
+  return 0;
+}
+
+// read all hashes from file, returns count; `out` should be freed by caller
+size_t h160_load(FILE *file, h160_t **out, size_t *lines) {
+  h160_reader_t r;
+  h160_reader_init(&r, file);
+
+  size_t size = 0, capacity = H160_CHUNK_MAX;
+  h160_t *hashes = malloc(capacity * sizeof(h160_t));
+  while (true) {
+    if (capacity - size < H160_CHUNK_MAX) {
+      capacity *= 2;
+      hashes = realloc(hashes, capacity * sizeof(h160_t));
+    }
+
+    size_t n = h160_read(&r, hashes + size);
+    if (n == 0) break;
+    size += n;
+  }
+
+  h160_reader_free(&r);
+  *out = hashes;
+  *lines = r.lines;
+  return size;
+}
+
+// MARK: hash index
+
+// exact match set of hash160 (for -f with list of hashes): entries are sorted and bucketed by top
+// `bits` of hash[0] (about one entry per bucket), so lookup is one offsets read and a short scan
+typedef struct hidx_t {
+  h160_t *hashes;
+  size_t count;
+  u32 *offsets; // bucket b is hashes[offsets[b] .. offsets[b + 1]]
+  u32 bits;
+} hidx_t;
+
+typedef struct {
+  h160_t *hashes;
+  const u32 *offsets;
+  size_t b0, b1; // bucket range
+} _hidx_sort_job_t;
+
+void *_hidx_sort_thread(void *arg) {
+  _hidx_sort_job_t *job = arg;
+  for (size_t b = job->b0; b < job->b1; ++b) {
+    size_t s = job->offsets[b], e = job->offsets[b + 1];
+    if (e - s > 8) {
+      qsort(job->hashes + s, e - s, sizeof(h160_t), compare_160);
+      continue;
+    }
+
+    for (size_t i = s + 1; i < e; ++i) { // insertion sort, most buckets have 0-2 items
+      h160_t t;
+      memcpy(t, job->hashes[i], sizeof(h160_t));
+      size_t j = i;
+      for (; j > s && compare_160(job->hashes[j - 1], t) > 0; --j) {
+        memcpy(job->hashes[j], job->hashes[j - 1], sizeof(h160_t));
+      }
+      memcpy(job->hashes[j], t, sizeof(h160_t));
+    }
   }
+  return NULL;
+}
 
-  queue_item_t *item = q->head;
-  q->head = item->next;
-  if (!q->head) q->tail = NULL;
+void hidx_init(hidx_t *idx, h160_t *hashes, size_t count) {
+  // takes ownership of `hashes`, duplicates are removed
+  assert(count < UINT32_MAX);
+  u32 bits = 4;
+  while (bits < 24 && ((size_t)1 << bits) < count) bits += 1;
+  size_t nb = (size_t)1 << bits;
+
+  u32 *offsets = calloc(nb + 1, sizeof(u32));
+  for (size_t i = 0; i < count; ++i) offsets[(hashes[i][0] >> (32 - bits)) + 1] += 1;
+  for (size_t b = 0; b < nb; ++b) offsets[b + 1] += offsets[b];
+
+  // counting sort by bucket
+  h160_t *sorted = malloc(MAX(count, 1ul) * sizeof(h160_t));
+  u32 *pos = malloc(nb * sizeof(u32));
+  memcpy(pos, offsets, nb * sizeof(u32));
+  for (size_t i = 0; i < count; ++i) {
+    memcpy(sorted[pos[hashes[i][0] >> (32 - bits)]++], hashes[i], sizeof(h160_t));
+  }
+  free(pos);
+  free(hashes);
+
+  // sort inside buckets (in parallel, buckets are independent)
+  size_t parts = MIN((size_t)get_cpu_count(), count / (1 << 16) + 1);
+  parts = MIN(parts, 64ul);
+  _hidx_sort_job_t jobs[64];
+  pthread_t threads[64];
+  for (size_t i = 0; i < parts; ++i) {
+    jobs[i] = (_hidx_sort_job_t){sorted, offsets, nb * i / parts, nb * (i + 1) / parts};
+    if (parts > 1) pthread_create(&threads[i], NULL, _hidx_sort_thread, &jobs[i]);
+    else _hidx_sort_thread(&jobs[i]);
+  }
+  for (size_t i = 0; parts > 1 && i < parts; ++i) pthread_join(threads[i], NULL);
+
+  // remove duplicates (they are always in the same bucket)
+  size_t w = 0;
+  for (size_t b = 0; b < nb; ++b) {
+    size_t s = offsets[b], e = offsets[b + 1];
+    offsets[b] = w;
+    for (size_t i = s; i < e; ++i) {
+      if (i > s && memcmp(sorted[i], sorted[i - 1], sizeof(h160_t)) == 0) continue;
+      if (w != i) memcpy(sorted[w], sorted[i], sizeof(h160_t));
+      w += 1;
+    }
+  }
+  offsets[nb] = w;
 
-  void *data_ptr = item->data_ptr;
-  free(item);
-  q->size -= 1;
+  idx->hashes = sorted;
+  idx->count = w;
+  idx->offsets = offsets;
+  idx->bits = bits;
+}
 
-  pthread_cond_signal(&q->cond_put);
-  pthread_mutex_unlock(&q->lock);
-  return data_ptr;
+INLINE bool hidx_has(const hidx_t *idx, const h160_t h) {
+  u32 b = h[0] >> (32 - idx->bits);
+  for (u32 i = idx->offsets[b]; i < idx->offsets[b + 1]; ++i) {
+    const u32 *x = idx->hashes[i];
+    if (x[0] > h[0]) break; // bucket is sorted
+    if (x[0] == h[0] && x[1] == h[1] && x[2] == h[2] && x[3] == h[3] && x[4] == h[4]) return true;
+  }
+  return false;
 }
 
 // MARK: bloom filter
 
 #define BLF_MAGIC 0x45434246 // FourCC: ECBF
-#define BLF_VERSION 1
+#define BLF_VERSION 2        // v1 still can be loaded
+#define BLF_BLOCK_WORDS 8    // v2: u64 words in one block (64 bytes, one cache line)
+#define BLF_FLAG_PAGE 0x10000 // header padded to BLF_PAGE_SIZE, so bits can be mmap'ed
+#define BLF_PAGE_SIZE 4096
+
+// v1: classic filter, 20 bits of item spread over the whole bit array
+// v2: blocked (split block) filter, item sets 16 bits in one 64 byte block, one bit in each
+//     32 bit word of it, so a probe is a single memory access and one SIMD test
+
+// hash -> bit (v1) or block (v2) index reduction, stored in header (upper bits of version)
+#define BLF_IDX_MOD 0  // x % n (v1 files)
+#define BLF_IDX_POW2 1 // x & (n - 1), size rounded up to power of two
+#define BLF_IDX_FAST 2 // (x * n) >> 64, "fastrange" (lemire.me/blog/2016/06/27)
+
+typedef struct blf_t blf_t;
+typedef void (*blf_batch_fn)(const blf_t *blf, const h160x_t hashes, size_t n, u32 *out_mask);
 
 typedef struct blf_t {
-  size_t size;
+  size_t size; // in u64 words
   u64 *bits;
+  u32 version;
+  u32 index;             // BLF_IDX_*
+  blf_batch_fn has_batch; // probe specialized for version & index, set in blf_init
+  size_t map_size;        // > 0 if bits are mmap'ed from file (read-only)
 } blf_t;
 
-static inline void blf_setbit(blf_t *blf, size_t idx) {
-  blf->bits[idx % (blf->size * 64) / 64] |= (u64)1 << (idx % 64);
+static const u32 BLF_SALT[16] = {
+    0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d, 0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31,
+    0x9e3779b1, 0x85ebca77, 0xc2b2ae3d, 0x27d4eb2f, 0x165667b1, 0xfd7046c5, 0xb55a4f09, 0x6c8e9cf5,
+};
+
+INLINE u64 blf_reduce(u64 x, u64 n, const u32 index) {
+  if (index == BLF_IDX_POW2) return x & (n - 1);
+  if (index == BLF_IDX_FAST) return (u64)(((u128)x * n) >> 64);
+  return x % n;
 }
 
-static inline bool blf_getbit(blf_t *blf, u64 idx) {
-  return (blf->bits[idx % (blf->size * 64) / 64] & ((u64)1 << (idx % 64))) != 0;
+static inline void blf_setbit(blf_t *blf, u64 x) {
+  u64 idx = blf_reduce(x, blf->size * 64, blf->index);
+  blf->bits[idx / 64] |= (u64)1 << (idx % 64);
+}
+
+static inline bool blf_getbit(const blf_t *blf, u64 x) {
+  u64 idx = blf_reduce(x, blf->size * 64, blf->index);
+  return (blf->bits[idx / 64] & ((u64)1 << (idx % 64))) != 0;
+}
+
+INLINE u32 *_blf2_block(const blf_t *blf, const u32 h0, const u32 h1, const u32 index) {
+  u64 nblocks = blf->size / BLF_BLOCK_WORDS;
+  u64 a = (u64)h0 << 32 | h1;
+  return (u32 *)(blf->bits + blf_reduce(a, nblocks, index) * BLF_BLOCK_WORDS);
+}
+
+static inline bool _blf2_test(const u32 *block, const u32 h2, const u32 h3) {
+  // words 0..7 use h2 as key, words 8..15 use h3; bit in word is top 5 bits of key * salt
+#if defined(__AVX512F__) && !defined(NO_SIMD)
+  __m512i k = _mm512_inserti64x4(_mm512_set1_epi32(h2), _mm256_set1_epi32(h3), 1);
+  k = _mm512_srli_epi32(_mm512_mullo_epi32(k, _mm512_loadu_si512(BLF_SALT)), 27);
+  __m512i m = _mm512_sllv_epi32(_mm512_set1_epi32(1), k);
+  __m512i b = _mm512_load_si512(block);
+  return _mm512_test_epi32_mask(_mm512_andnot_si512(b, m), m) == 0;
+#elif defined(__AVX2__) && !defined(NO_SIMD)
+  const __m256i one = _mm256_set1_epi32(1);
+  __m256i s0 = _mm256_loadu_si256((const __m256i *)BLF_SALT);
+  __m256i s1 = _mm256_loadu_si256((const __m256i *)(BLF_SALT + 8));
+  __m256i k0 = _mm256_mullo_epi32(_mm256_set1_epi32(h2), s0);
+  __m256i k1 = _mm256_mullo_epi32(_mm256_set1_epi32(h3), s1);
+  __m256i m0 = _mm256_sllv_epi32(one, _mm256_srli_epi32(k0, 27));
+  __m256i m1 = _mm256_sllv_epi32(one, _mm256_srli_epi32(k1, 27));
+  __m256i b0 = _mm256_load_si256((const __m256i *)block);
+  __m256i b1 = _mm256_load_si256((const __m256i *)(block + 8));
+  return _mm256_testc_si256(b0, m0) & _mm256_testc_si256(b1, m1);
+#else
+  for (int i = 0; i < 16; ++i) {
+    u32 m = (u32)1 << (((i < 8 ? h2 : h3) * BLF_SALT[i]) >> 27);
+    if ((block[i] & m) != m) return false;
+  }
+  return true;
+#endif
 }
 
 void blf_add(blf_t *blf, const h160_t hash) {
+  if (blf->version == 2) {
+    u32 *block = _blf2_block(blf, hash[0], hash[1], blf->index);
+    for (int i = 0; i < 16; ++i) {
+      block[i] |= (u32)1 << (((i < 8 ? hash[2] : hash[3]) * BLF_SALT[i]) >> 27);
+    }
+    return;
+  }
+
   u64 a1 = (u64)hash[0] << 32 | hash[1];
   u64 a2 = (u64)hash[2] << 32 | hash[3];
   u64 a3 = (u64)hash[4] << 32 | hash[0];
@@ -305,7 +816,42 @@ void blf_add(blf_t *blf, const h160_t hash) {
   }
 }
 
-bool blf_has(blf_t *blf, const h160_t hash) {
+// thread-safe version of blf_add (bits are set with atomic or), true if any bit was not set
+bool blf_add_atomic(blf_t *blf, const h160_t hash) {
+  u64 changed = 0;
+  if (blf->version == 2) {
+    u32 *block = _blf2_block(blf, hash[0], hash[1], blf->index);
+    for (int i = 0; i < 16; ++i) {
+      u32 m = (u32)1 << (((i < 8 ? hash[2] : hash[3]) * BLF_SALT[i]) >> 27);
+      if (__atomic_load_n(&block[i], __ATOMIC_RELAXED) & m) continue;
+      changed |= ~__atomic_fetch_or(&block[i], m, __ATOMIC_RELAXED) & m;
+    }
+    return changed != 0;
+  }
+
+  u64 a[5] = {
+      (u64)hash[0] << 32 | hash[1], (u64)hash[2] << 32 | hash[3], (u64)hash[4] << 32 | hash[0],
+      (u64)hash[1] << 32 | hash[2], (u64)hash[3] << 32 | hash[4],
+  };
+
+  u8 shifts[4] = {24, 28, 36, 40};
+  for (size_t i = 0; i < 4; ++i) {
+    u8 S = shifts[i];
+    for (size_t j = 0; j < 5; ++j) {
+      u64 idx = blf_reduce(a[j] << S | a[(j + 1) % 5] >> S, blf->size * 64, blf->index);
+      u64 m = (u64)1 << (idx % 64), *w = &blf->bits[idx / 64];
+      if (__atomic_load_n(w, __ATOMIC_RELAXED) & m) continue;
+      changed |= ~__atomic_fetch_or(w, m, __ATOMIC_RELAXED) & m;
+    }
+  }
+  return changed != 0;
+}
+
+bool blf_has(const blf_t *blf, const h160_t hash) {
+  if (blf->version == 2) {
+    return _blf2_test(_blf2_block(blf, hash[0], hash[1], blf->index), hash[2], hash[3]);
+  }
+
   u64 a1 = (u64)hash[0] << 32 | hash[1];
   u64 a2 = (u64)hash[2] << 32 | hash[3];
   u64 a3 = (u64)hash[4] << 32 | hash[0];
@@ -325,6 +871,166 @@ bool blf_has(blf_t *blf, const h160_t hash) {
   return true;
 }
 
+INLINE void _blf2_has_batch(const blf_t *blf, const h160x_t hashes, size_t n, u32 *out_mask,
+                            const u32 index) {
+  // one block per hash: prefetch all of them first, then test
+  u32 *blocks[HASH_BATCH_SIZE];
+  for (size_t i = 0; i < n; ++i) {
+    blocks[i] = _blf2_block(blf, hashes[0][i], hashes[1][i], index);
+    __builtin_prefetch(blocks[i]);
+  }
+
+  u32 mask = 0;
+  for (size_t i = 0; i < n; ++i) {
+    mask |= (u32)_blf2_test(blocks[i], hashes[2][i], hashes[3][i]) << i;
+  }
+
+  *out_mask = mask;
+}
+
+INLINE void _blf1_has_batch(const blf_t *blf, const h160x_t hashes, size_t n, u32 *out_mask,
+                            const u32 index) {
+  // same probes as blf_has, but for n hashes at once: indices of the next few probes of every
+  // still matching hash are computed & prefetched first, then tested, so cache misses overlap
+  const u8 shifts[4] = {24, 28, 36, 40};
+  const u64 nbits = blf->size * 64;
+
+  u64 a[HASH_BATCH_SIZE][5];
+  for (size_t i = 0; i < n; ++i) {
+    a[i][0] = (u64)hashes[0][i] << 32 | hashes[1][i];
+    a[i][1] = (u64)hashes[2][i] << 32 | hashes[3][i];
+    a[i][2] = (u64)hashes[4][i] << 32 | hashes[0][i];
+    a[i][3] = (u64)hashes[1][i] << 32 | hashes[2][i];
+    a[i][4] = (u64)hashes[3][i] << 32 | hashes[4][i];
+  }
+
+  u32 mask = n < 32 ? (1u << n) - 1 : ~0u;
+  u64 idx[HASH_BATCH_SIZE][5];
+
+  // one step is 5 probes with the same shift (blf_has order), most hashes fail in first step
+  for (size_t k = 0; k < 4 && mask; ++k) {
+    u8 S = shifts[k];
+    for (size_t i = 0; i < n; ++i) {
+      if (!(mask & (1u << i))) continue;
+      for (size_t j = 0; j < 5; ++j) {
+        idx[i][j] = blf_reduce(a[i][j] << S | a[i][(j + 1) % 5] >> S, nbits, index);
+        __builtin_prefetch(&blf->bits[idx[i][j] / 64]);
+      }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      if (!(mask & (1u << i))) continue;
+      for (size_t j = 0; j < 5; ++j) {
+        if (blf->bits[idx[i][j] / 64] & ((u64)1 << (idx[i][j] % 64))) continue;
+        mask &= ~(1u << i);
+        break;
+      }
+    }
+  }
+
+  *out_mask = mask;
+}
+
+// one copy of batch probe per version & index, so reduction is inlined without a branch
+#define BLF_BATCH_FN(v, i)                                                                         \
+  void _blf##v##_has_batch_##i(const blf_t *blf, const h160x_t hs, size_t n, u32 *out_mask) {      \
+    _blf##v##_has_batch(blf, hs, n, out_mask, BLF_IDX_##i);                                        \
+  }
+
+BLF_BATCH_FN(1, MOD)
+BLF_BATCH_FN(1, POW2)
+BLF_BATCH_FN(1, FAST)
+BLF_BATCH_FN(2, MOD)
+BLF_BATCH_FN(2, POW2)
+BLF_BATCH_FN(2, FAST)
+
+void _blf_setup(blf_t *blf, size_t size, u32 version, u32 index) {
+  // v2 blocks should be cache line aligned
+  assert(version == 1 || size % BLF_BLOCK_WORDS == 0);
+  assert(index != BLF_IDX_POW2 || (size & (size - 1)) == 0);
+
+  static const blf_batch_fn batch_fns[2][3] = {
+      {_blf1_has_batch_MOD, _blf1_has_batch_POW2, _blf1_has_batch_FAST},
+      {_blf2_has_batch_MOD, _blf2_has_batch_POW2, _blf2_has_batch_FAST},
+  };
+
+  blf->size = size;
+  blf->version = version;
+  blf->index = index;
+  blf->has_batch = batch_fns[version - 1][index];
+  blf->map_size = 0;
+}
+
+void blf_init(blf_t *blf, size_t size, u32 version, u32 index) {
+  _blf_setup(blf, size, version, index);
+  blf->bits = aligned_alloc(64, (size * sizeof(u64) + 63) / 64 * 64);
+  memset(blf->bits, 0, size * sizeof(u64));
+}
+
+void blf_has_batch(const blf_t *blf, const h160x_t hashes, size_t n, u32 *out_mask) {
+  assert(n <= HASH_BATCH_SIZE && n <= 32);
+  blf->has_batch(blf, hashes, n, out_mask);
+}
+
+size_t blf_size(u64 n, u32 version, u32 index) {
+  // https://hur.st/bloomfilter/?n=500M&p=1e9&m=&k=20
+  double p = 1.0 / 1e9;
+  u64 m = (u64)(n * log(p) / log(1.0 / pow(2.0, log(2.0))));
+
+  // blocked filter needs ~2x bits for the same p (~86 bits per item vs ~43 for 1e-9)
+  u64 unit = version == 1 ? 64 : 64 * BLF_BLOCK_WORDS;
+  u64 units = version == 1 ? (m + unit - 1) / unit : (2 * m + unit - 1) / unit;
+  if (version == 2) units = (units + 63) / 64 * 64; // so it can be folded up to 64x (blf_fold)
+  if (index == BLF_IDX_POW2) {
+    u64 p2 = 1;
+    while (p2 < units) p2 <<= 1;
+    units = p2;
+  }
+
+  return units * (unit / 64);
+}
+
+// builds smaller v2 filter with the same index mode from src: each block of dst is OR of all
+// src blocks that map to it, so dst has every item of src (with more false positives)
+// returns false if src is v1 or its block count can't be divided down to max_size words
+bool blf_fold(blf_t *dst, const blf_t *src, size_t max_size) {
+  if (src->version != 2) return false;
+
+  size_t nblocks = src->size / BLF_BLOCK_WORDS, factor = 1;
+  while (nblocks / factor * BLF_BLOCK_WORDS > max_size && nblocks % (factor * 2) == 0) factor *= 2;
+  if (nblocks / factor * BLF_BLOCK_WORDS > max_size) return false;
+
+  // fast: (x * n * f) >> 64 == block, so (x * n) >> 64 == block / f
+  // mod & pow2: n divides src block count, so x % n == block % n
+  size_t n = nblocks / factor;
+  blf_init(dst, n * BLF_BLOCK_WORDS, 2, src->index);
+  for (size_t i = 0; i < nblocks; ++i) {
+    size_t j = src->index == BLF_IDX_FAST ? i / factor : i % n;
+    u64 *d = dst->bits + j * BLF_BLOCK_WORDS, *s = src->bits + i * BLF_BLOCK_WORDS;
+    for (size_t k = 0; k < BLF_BLOCK_WORDS; ++k) d[k] |= s[k];
+  }
+
+  return true;
+}
+
+// share of set bits, for v2 filter probe of a random hash passes with ~fill^16 chance
+double blf_fill(const blf_t *blf) {
+  size_t ones = 0;
+  for (size_t i = 0; i < blf->size; ++i) ones += __builtin_popcountll(blf->bits[i]);
+  return (double)ones / (blf->size * 64);
+}
+
+void blf_free(blf_t *blf) {
+  if (blf->map_size > 0) {
+    file_unmap((u8 *)blf->bits - BLF_PAGE_SIZE, blf->map_size);
+    blf->bits = NULL;
+    return;
+  }
+
+  free(blf->bits);
+  blf->bits = NULL;
+}
+
 bool blf_save(const char *filepath, blf_t *blf) {
   FILE *file = fopen(filepath, "wb");
   if (file == NULL) {
@@ -332,21 +1038,16 @@ bool blf_save(const char *filepath, blf_t *blf) {
     exit(1);
   }
 
+  // header: magic, version (| index << 8 | flags), size; zero padded to page size
+  u8 header[BLF_PAGE_SIZE] = {0};
   u32 blf_magic = BLF_MAGIC;
-  u32 blg_version = BLF_VERSION;
+  u32 blf_version = blf->version | blf->index << 8 | BLF_FLAG_PAGE;
+  memcpy(header + 0, &blf_magic, sizeof(blf_magic));
+  memcpy(header + 4, &blf_version, sizeof(blf_version));
+  memcpy(header + 8, &blf->size, sizeof(blf->size));
 
-  if (fwrite(&blf_magic, sizeof(blf_magic), 1, file) != 1) {
-    fprintf(stderr, "failed to write bloom filter magic\n");
-    return false;
-  };
-
-  if (fwrite(&blg_version, sizeof(blg_version), 1, file) != 1) {
-    fprintf(stderr, "failed to write bloom filter version\n");
-    return false;
-  }
-
-  if (fwrite(&blf->size, sizeof(blf->size), 1, file) != 1) {
-    fprintf(stderr, "failed to write bloom filter size\n");
+  if (fwrite(header, sizeof(header), 1, file) != 1) {
+    fprintf(stderr, "failed to write bloom filter header\n");
     return false;
   }
 
@@ -359,53 +1060,124 @@ bool blf_save(const char *filepath, blf_t *blf) {
   return true;
 }
 
-bool blf_load(const char *filepath, blf_t *blf) {
-  FILE *file = fopen(filepath, "rb");
-  if (file == NULL) {
-    fprintf(stderr, "failed to open input file\n");
-    return false;
-  }
-
+// reads header, returns offset of bits in file or 0 on error
+size_t _blf_read_header(FILE *file, u32 *version, u32 *index, size_t *size) {
   u32 blf_magic, blf_version;
-  size_t size;
 
   bool is_ok = true;
   is_ok = is_ok && fread(&blf_magic, sizeof(blf_magic), 1, file) == 1;
   is_ok = is_ok && fread(&blf_version, sizeof(blf_version), 1, file) == 1;
-  is_ok = is_ok && fread(&size, sizeof(size), 1, file) == 1;
+  is_ok = is_ok && fread(size, sizeof(*size), 1, file) == 1;
   if (!is_ok) {
     fprintf(stderr, "failed to read bloom filter header\n");
-    return false;
+    return 0;
   }
 
-  if (blf_magic != BLF_MAGIC || blf_version != BLF_VERSION) {
+  size_t offset = blf_version & BLF_FLAG_PAGE ? BLF_PAGE_SIZE : 16; // older files: no padding
+  *index = blf_version >> 8 & 0xff;
+  *version = blf_version & 0xff;
+
+  bool is_v1 = *version == 1, is_v2 = *version == 2 && *size % BLF_BLOCK_WORDS == 0;
+  bool is_idx = *index <= BLF_IDX_FAST && (*index != BLF_IDX_POW2 || (*size & (*size - 1)) == 0);
+  bool is_flags = (blf_version & ~(BLF_FLAG_PAGE | 0xffff)) == 0;
+  if (blf_magic != BLF_MAGIC || !(is_v1 || is_v2) || !is_idx || !is_flags || *size == 0) {
     fprintf(stderr, "invalid bloom filter version; create a new filter with blf-gen command\n");
+    return 0;
+  }
+
+  return offset;
+}
+
+bool blf_load(const char *filepath, blf_t *blf) {
+  FILE *file = fopen(filepath, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "failed to open input file\n");
+    return false;
+  }
+
+  u32 version, index;
+  size_t size, offset = _blf_read_header(file, &version, &index, &size);
+  if (offset == 0 || fseek(file, offset, SEEK_SET) != 0) {
+    fclose(file);
     return false;
   }
 
-  u64 *bits = calloc(size, sizeof(u64));
-  if (fread(bits, sizeof(u64), size, file) != size) {
+  blf_init(blf, size, version, index);
+  if (fread(blf->bits, sizeof(u64), size, file) != size) {
     fprintf(stderr, "failed to read bloom filter bits\n");
+    fclose(file);
     return false;
   }
 
   fclose(file);
-  blf->size = size;
-  blf->bits = bits;
+  return true;
+}
+
+// read-only load without copy: bits are mapped from page cache, so they are shared between
+// processes using the same file and startup does not read whole file into private memory;
+// files without page aligned header (older versions) are loaded with blf_load
+bool blf_map(const char *filepath, blf_t *blf, bool populate) {
+  FILE *file = fopen(filepath, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "failed to open input file\n");
+    return false;
+  }
+
+  u32 version, index;
+  size_t size, offset = _blf_read_header(file, &version, &index, &size);
+  if (offset == 0) {
+    fclose(file);
+    return false;
+  }
+
+  void *ptr = NULL;
+  size_t map_size = offset + size * sizeof(u64);
+  if (offset == BLF_PAGE_SIZE) ptr = file_map(file, map_size, populate);
+  fclose(file);
+
+  if (ptr == NULL) return blf_load(filepath, blf);
+
+  _blf_setup(blf, size, version, index);
+  blf->bits = (u64 *)((u8 *)ptr + offset);
+  blf->map_size = map_size;
   return true;
 }
 
 // MARK: blf-gen command
 
 void __blf_gen_usage(args_t *args) {
-  printf("Usage: %s blf-gen -n <count> -o <file>\n", args->argv[0]);
+  printf("Usage: %s blf-gen -n <count> -o <file> [-idx <mode>] [-t <threads>]\n", args->argv[0]);
   printf("Generate a bloom filter from a list of hex-encoded hash160 values passed to stdin.\n");
   printf("\nOptions:\n");
   printf("  -n <count>      - Number of hashes to add.\n");
   printf("  -o <file>       - File to write bloom filter (must have a .blf extension).\n");
+  printf("  -idx <mode>     - Index reduction: fast (default), pow2 (power of two size), mod.\n");
+  printf("  -t <threads>    - Number of threads to use (default: all cores).\n");
   exit(1);
 }
 
+typedef struct {
+  blf_t *blf;
+  const h160_t *hashes;
+  size_t count;
+  u64 added;
+} _blf_gen_job_t;
+
+void *_blf_gen_thread(void *arg) {
+  _blf_gen_job_t *job = arg;
+  for (size_t i = 0; i < job->count; ++i) job->added += blf_add_atomic(job->blf, job->hashes[i]);
+  return NULL;
+}
+
+void _blf_gen_single(_blf_gen_job_t *job) {
+  // no other writers, so plain loads and stores (atomic or is ~2x slower)
+  for (size_t i = 0; i < job->count; ++i) {
+    if (blf_has(job->blf, job->hashes[i])) continue;
+    blf_add(job->blf, job->hashes[i]);
+    job->added += 1;
+  }
+}
+
 void blf_gen(args_t *args) {
   u64 n = args_uint(args, "-n", 0);
   if (n == 0) {
@@ -419,12 +1191,17 @@ void blf_gen(args_t *args) {
     return __blf_gen_usage(args);
   }
 
-  // https://hur.st/bloomfilter/?n=500M&p=1e9&m=&k=20
-  u64 r = 1e9;
-  double p = 1.0 / (double)r;
-  u64 m = (u64)(n * log(p) / log(1.0 / pow(2.0, log(2.0))));
-  double mb = (double)m / 8 / 1024 / 1024;
-  size_t size = (m + 63) / 64;
+  char *idx_arg = arg_str(args, "-idx");
+  u32 index = BLF_IDX_FAST;
+  if (idx_arg != NULL) {
+    if (strcmp(idx_arg, "fast") == 0) index = BLF_IDX_FAST;
+    else if (strcmp(idx_arg, "pow2") == 0) index = BLF_IDX_POW2;
+    else if (strcmp(idx_arg, "mod") == 0) index = BLF_IDX_MOD;
+    else {
+      fprintf(stderr, "[!] invalid index mode: %s\n", idx_arg);
+      return __blf_gen_usage(args);
+    }
+  }
 
   blf_t blf = {.size = 0, .bits = NULL};
   if (access(filepath, F_OK) == 0) {
@@ -436,6 +1213,7 @@ void blf_gen(args_t *args) {
       exit(1);
     }
 
+    size_t size = blf_size(n, blf.version, blf.index); // keep format of existing file
     if (blf.size != size) {
       fprintf(stderr, "[!] bloom filter size mismatch (%'zu != %'zu): %s\n", blf.size, size, todo);
       exit(1);
@@ -444,34 +1222,52 @@ void blf_gen(args_t *args) {
     printf("updating bloom filter...\n");
   } else {
     printf("creating bloom filter...\n");
-    blf.size = size;
-    blf.bits = calloc(blf.size, sizeof(u64));
+    blf_init(&blf, blf_size(n, BLF_VERSION, index), BLF_VERSION, index);
   }
 
-  printf("bloom filter params: n = %'llu | p = 1:%'llu | m = %'llu (%'.1f MB)\n", n, r, m, mb);
-
-  u64 count = 0;
-  hex40 line;
-  while (fgets(line, sizeof(line), stdin) != NULL) {
-    if (strlen(line) != sizeof(line) - 1) continue;
+  const char *idx_names[] = {"mod", "pow2", "fast"};
+  u64 m = blf.size * 64;
+  double mb = (double)m / 8 / 1024 / 1024;
+  printf("bloom filter params: n = %'llu | p = 1:%'llu | m = %'llu (%'.1f MB) | v%u %s\n", n,
+         (u64)1e9, m, mb, blf.version, idx_names[blf.index]);
 
-    h160_t hash;
-    for (size_t j = 0; j < sizeof(line) - 1; j += 8) sscanf(line + j, "%8x", &hash[j / 8]);
+  // every chunk of input is split between threads, bits are set with atomic or
+  size_t threads = MIN(MAX(args_uint(args, "-t", get_cpu_count()), 1ul), 64ul);
+  _blf_gen_job_t jobs[64];
+  pthread_t tids[64];
 
-    if (blf_has(&blf, hash)) continue;
+  u64 count = 0;
+  size_t stime = tsnow();
+  h160_reader_t reader;
+  h160_reader_init(&reader, stdin);
+  h160_t *hashes = malloc(H160_CHUNK_MAX * sizeof(h160_t));
+  for (size_t n = 0; (n = h160_read(&reader, hashes)) > 0;) {
+    size_t parts = MIN(threads, n / 1024 + 1);
+    for (size_t i = 0; i < parts; ++i) {
+      size_t s = n * i / parts, e = n * (i + 1) / parts;
+      jobs[i] = (_blf_gen_job_t){.blf = &blf, .hashes = hashes + s, .count = e - s, .added = 0};
+      if (parts > 1) pthread_create(&tids[i], NULL, _blf_gen_thread, &jobs[i]);
+      else _blf_gen_single(&jobs[i]);
+    }
 
-    blf_add(&blf, hash);
-    count += 1;
+    for (size_t i = 0; i < parts; ++i) {
+      if (parts > 1) pthread_join(tids[i], NULL);
+      count += jobs[i].added;
+    }
   }
 
+  double dt = MAX(tsnow() - stime, 1ul) / 1000.0;
+  printf("read %'zu lines in %.2fs (%.2fM lines/s)\n", reader.lines, dt, reader.lines / dt / 1e6);
   printf("added %'llu new items; saving to %s\n", count, filepath);
+  h160_reader_free(&reader);
+  free(hashes);
 
   if (!blf_save(filepath, &blf)) {
     fprintf(stderr, "[!] failed to save bloom filter\n");
     exit(1);
   }
 
-  free(blf.bits);
+  blf_free(&blf);
 }
 
 // MARK: blf-check command
@@ -487,12 +1283,6 @@ void __blf_check_usage(args_t *args) {
   exit(1);
 }
 
-bool __blf_check_hex(blf_t *blf, const char *hex) {
-  h160_t h = {0};
-  for (size_t i = 0; i < 40; i += 8) sscanf(hex + i, "%8x", &h[i / 8]);
-  return blf_has(blf, h);
-}
-
 void blf_check(args_t *args) {
   char *filepath = arg_str(args, "-f");
   if (filepath == NULL) {
@@ -501,44 +1291,36 @@ void blf_check(args_t *args) {
   }
 
   blf_t blf = {.size = 0, .bits = NULL};
-  if (!blf_load(filepath, &blf)) {
+  if (!blf_map(filepath, &blf, false)) {
     fprintf(stderr, "[!] failed to load bloom filter\n");
     exit(1);
   }
 
   bool has_opts = false;
   for (int i = 1; i < args->argc; ++i) {
-    if (strlen(args->argv[i]) != 40) continue;
+    h160_t h;
+    if (strlen(args->argv[i]) != 40 || !h160_from_hex(h, args->argv[i])) continue;
 
     has_opts = true;
-    bool found = __blf_check_hex(&blf, args->argv[i]);
-    printf("%s %s\n", args->argv[i], found ? "FOUND" : "NOT FOUND");
+    printf("%s %s\n", args->argv[i], blf_has(&blf, h) ? "FOUND" : "NOT FOUND");
   }
 
   if (has_opts) return;
 
-  char line[128];
-  while (fgets(line, sizeof(line), stdin) != NULL) {
-    strtrim(line);
-    // printf("checking %s (%'zu)...\n", line, strlen(line));
-    if (strlen(line) != 40) continue; // 40 hex chars + \n
-
-    bool found = __blf_check_hex(&blf, line);
-    printf("%s %s\n", line, found ? "FOUND" : "NOT FOUND");
+  h160_reader_t reader;
+  h160_reader_init(&reader, stdin);
+  h160_t *hashes = malloc(H160_CHUNK_MAX * sizeof(h160_t));
+  for (size_t n = 0; (n = h160_read(&reader, hashes)) > 0;) {
+    for (size_t i = 0; i < n; ++i) {
+      const u32 *h = hashes[i];
+      printf("%08x%08x%08x%08x%08x %s\n", h[0], h[1], h[2], h[3], h[4],
+             blf_has(&blf, h) ? "FOUND" : "NOT FOUND");
+    }
+    fflush(stdout);
   }
-}
 
-// Mark: CPU count
-
-int get_cpu_count() {
-#ifdef _WIN32
-  SYSTEM_INFO sysinfo;
-  GetSystemInfo(&sysinfo);
-  return (int)sysinfo.dwNumberOfProcessors;
-#else
-  int cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
-  return MAX(1, cpu_count);
-#endif
+  h160_reader_free(&reader);
+  free(hashes);
 }
 
 // MARK: TTY
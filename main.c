@@ -2,32 +2,56 @@
 // https://github.com/vladkens/ecloop
 // Licensed under the MIT License.
 
+#include <errno.h>
 #include <locale.h>
 #include <pthread.h>
 #include <signal.h>
+#include <stdalign.h>
+#include <stdatomic.h>
 #include <unistd.h>
 
 #include "lib/addr.c"
 #include "lib/bench.c"
 #include "lib/ecc.c"
+#include "lib/ecc_simd.c"
+#include "lib/fuse.c"
 #include "lib/utils.c"
 
 #define VERSION "0.5.0"
 #define MAX_JOB_SIZE 1024 * 1024 * 2
-#define GROUP_INV_SIZE 2048ul
+#define GROUP_INV_SIZE 2048ul // default group size (-g, autotune)
+#define GROUP_INV_MIN 64ul
+#define GROUP_INV_MAX 16384ul
 #define MAX_LINE_SIZE 1025
+#define STATUS_INTERVAL_MS 100
 
-static_assert(GROUP_INV_SIZE % HASH_BATCH_SIZE == 0,
+static_assert(GROUP_INV_SIZE % HASH_BATCH_SIZE == 0 && GROUP_INV_MIN % HASH_BATCH_SIZE == 0,
               "GROUP_INV_SIZE must be divisible by HASH_BATCH_SIZE");
 
 enum Cmd { CMD_NIL, CMD_ADD, CMD_MUL, CMD_RND };
 
+// each worker stats placed in own cache line to avoid false sharing between threads
+typedef struct worker_t {
+  alignas(64) _Atomic size_t k_checked; // keys checked by this thread (written only by owner)
+  _Atomic size_t ts_updated;            // timestamp of last update (written only by owner)
+  struct ctx_t *ctx;
+  pthread_t thread;
+
+  // filter stages stats: hashes probed, passed prefilter, passed filter, matched (owner only)
+  size_t k_stages[4];
+
+  // scratch for batch routines, only grows, so jobs after the first one do not allocate
+  void *scratch;
+  size_t scratch_size;
+} worker_t;
+
 typedef struct ctx_t {
   enum Cmd cmd;
   pthread_mutex_t lock;
   size_t threads_count;
-  pthread_t *threads;
-  size_t k_checked;
+  worker_t *workers;
+  pthread_t reporter;
+  _Atomic bool reporter_stop;
   size_t k_found;
   bool check_addr33;
   bool check_addr65;
@@ -40,27 +64,32 @@ typedef struct ctx_t {
   bool finished;       // true if the program is exiting
   bool paused;         // true if the program is paused
   size_t ts_started;   // timestamp of start
-  size_t ts_updated;   // timestamp of last update
-  size_t ts_printed;   // timestamp of last print
   size_t ts_paused_at; // timestamp when paused
   size_t paused_time;  // time spent in paused state
 
   // filter file (bloom filter or hashes to search)
-  h160_t *to_find_hashes;
-  size_t to_find_count;
+  hidx_t hidx; // exact match index, if filter is a list of hashes
   blf_t blf;
+  fuse_t fuse; // used instead of bloom filter if loaded (fuse.fps != NULL)
+  blf_t pf;    // optional small prefilter checked first (pf.bits != NULL), fits in L2 / L3
 
   // cmd add
   fe range_s;  // search range start
   fe range_e;  // search range end
   fe stride_k; // precomputed stride key (step for G-points, 2^offset)
   pe stride_p; // precomputed stride point (G * pk)
-  pe gpoints[GROUP_INV_SIZE];
+  size_t group_size; // points per group inversion (also keys per job in cmd mul)
+  fe *gpoints_x;     // precomputed G-points (affine, x and y kept in separate arrays)
+  fe *gpoints_y;
   size_t job_size;
+  u64 job_count;        // number of jobs in current range
+  _Atomic u64 job_next; // next job index to take by worker
 
   // cmd mul
-  queue_t queue;
+  queue_t queue; // jobs to process
+  queue_t pool;  // free jobs to reuse
   bool raw_text;
+  bool bin_input; // 32 byte big-endian keys instead of text lines
 
   // cmd rnd
   bool has_seed;
@@ -68,7 +97,8 @@ typedef struct ctx_t {
   u32 ord_size; // size (span) in range to search
 } ctx_t;
 
-void load_filter(ctx_t *ctx, const char *filepath) {
+void load_filter(ctx_t *ctx, const char *filepath, bool populate) {
+  // populate: read mapped filter file now, otherwise pages are faulted in on first probes
   if (!filepath) {
     fprintf(stderr, "missing filter file\n");
     exit(1);
@@ -80,66 +110,99 @@ void load_filter(ctx_t *ctx, const char *filepath) {
     exit(1);
   }
 
+  // filter type by magic (or .blf extension), otherwise list of hashes
+  u32 magic = 0;
+  if (fread(&magic, sizeof(magic), 1, file) != 1 || fseek(file, 0, SEEK_SET) != 0) magic = 0;
+
   char *ext = strrchr(filepath, '.');
-  if (ext != NULL && strcmp(ext, ".blf") == 0) {
-    if (!blf_load(filepath, &ctx->blf)) exit(1);
+  if (magic == BLF_MAGIC || (ext != NULL && strcmp(ext, ".blf") == 0)) {
+    if (!blf_map(filepath, &ctx->blf, populate)) exit(1);
     fclose(file);
     return;
   }
 
-  size_t hlen = sizeof(u32) * 5;
-  assert(hlen == sizeof(h160_t));
-  size_t capacity = 32;
-  size_t size = 0;
-  u32 *hashes = malloc(capacity * hlen);
+  if (magic == FUSE_MAGIC) {
+    if (!fuse_load(filepath, &ctx->fuse, populate)) exit(1);
+    fclose(file);
+    return;
+  }
 
-  hex40 line;
-  while (fgets(line, sizeof(line), file)) {
-    if (strlen(line) != sizeof(line) - 1) continue;
+  size_t stime = tsnow(), lines = 0;
+  h160_t *hashes = NULL;
+  size_t size = h160_load(file, &hashes, &lines);
+  fclose(file);
 
-    if (size >= capacity) {
-      capacity *= 2;
-      hashes = realloc(hashes, capacity * hlen);
-    }
+  hidx_init(&ctx->hidx, hashes, size);
+  double dt = MAX(tsnow() - stime, 1ul) / 1000.0;
+  printf("loaded %'zu hashes from %'zu lines in %.2fs (%.2fM lines/s)\n", ctx->hidx.count,
+         lines, dt, lines / dt / 1e6);
 
-    for (size_t j = 0; j < sizeof(line) - 1; j += 8) {
-      sscanf(line + j, "%8x", &hashes[size * 5 + j / 8]);
-    }
+  // generate in-memory bloom filter
+  size_t nblocks = MAX((ctx->hidx.count * 2 + BLF_BLOCK_WORDS - 1) / BLF_BLOCK_WORDS, 1ul);
+  blf_init(&ctx->blf, nblocks * BLF_BLOCK_WORDS, BLF_VERSION, BLF_IDX_FAST);
+  for (size_t i = 0; i < ctx->hidx.count; ++i) blf_add(&ctx->blf, ctx->hidx.hashes[i]);
+}
+
+void load_prefilter(ctx_t *ctx, size_t size_kb) {
+  if (size_kb == 0) return;
 
-    size += 1;
+  size_t max_size = size_kb * 1024 / sizeof(u64) / BLF_BLOCK_WORDS * BLF_BLOCK_WORDS;
+  if (ctx->fuse.fps != NULL || max_size == 0) {
+    printf("prefilter: not supported for this filter, skipped\n");
+    return;
   }
 
-  fclose(file);
-  qsort(hashes, size, hlen, compare_160);
-
-  // remove duplicates
-  size_t unique_count = 0;
-  for (size_t i = 1; i < size; ++i) {
-    if (memcmp(&hashes[unique_count * 5], &hashes[i * 5], hlen) != 0) {
-      unique_count++;
-      memcpy(&hashes[unique_count * 5], &hashes[i * 5], hlen);
-    }
+  if (ctx->blf.size <= max_size) {
+    printf("prefilter: filter is already %'zu KB, skipped\n", ctx->blf.size * 8 / 1024);
+    return;
   }
 
-  ctx->to_find_hashes = (h160_t *)hashes;
-  ctx->to_find_count = unique_count + 1;
+  if (ctx->hidx.hashes != NULL) {
+    // built from the same hashes as the main filter
+    blf_init(&ctx->pf, max_size, BLF_VERSION, BLF_IDX_FAST);
+    for (size_t i = 0; i < ctx->hidx.count; ++i) blf_add(&ctx->pf, ctx->hidx.hashes[i]);
+  } else if (!blf_fold(&ctx->pf, &ctx->blf, max_size)) {
+    // hashes are not known, so only v2 filter with suitable block count can be reduced
+    printf("prefilter: can't fold this bloom filter to %'zu KB, skipped\n", size_kb);
+    return;
+  }
 
-  // generate in-memory bloom filter
-  ctx->blf.size = ctx->to_find_count * 2;
-  ctx->blf.bits = malloc(ctx->blf.size * sizeof(u64));
-  for (size_t i = 0; i < ctx->to_find_count; ++i) blf_add(&ctx->blf, hashes + i * 5);
+  double fill = blf_fill(&ctx->pf), p = fill * fill;
+  p = p * p, p = p * p, p = p * p; // fill^16 ~ chance of random hash to pass
+  printf("prefilter: %'zu KB ~ %.1f%% bits set ~ %.3f%% expected to pass\n",
+         ctx->pf.size * 8 / 1024, fill * 100, p * 100);
+}
+
+size_t ctx_k_checked(ctx_t *ctx) {
+  // sum of per-thread counters; values may lag behind a bit, which is fine for stats
+  size_t k_checked = 0;
+  for (size_t i = 0; i < ctx->threads_count; ++i) {
+    k_checked += atomic_load_explicit(&ctx->workers[i].k_checked, memory_order_relaxed);
+  }
+  return k_checked;
+}
+
+size_t ctx_ts_updated(ctx_t *ctx) {
+  size_t ts_updated = ctx->ts_started;
+  for (size_t i = 0; i < ctx->threads_count; ++i) {
+    size_t ts = atomic_load_explicit(&ctx->workers[i].ts_updated, memory_order_relaxed);
+    ts_updated = MAX(ts_updated, ts);
+  }
+  return ts_updated;
 }
 
 // note: this function is not thread-safe; use mutex lock before calling
 void ctx_print_unlocked(ctx_t *ctx) {
   char *msg = ctx->finished ? "" : (ctx->paused ? " ('r' – resume)" : " ('p' – pause)");
 
-  int64_t effective_time = (int64_t)(ctx->ts_updated - ctx->ts_started) - (int64_t)ctx->paused_time;
+  size_t ts_updated = ctx_ts_updated(ctx);
+  int64_t effective_time = (int64_t)(ts_updated - ctx->ts_started) - (int64_t)ctx->paused_time;
   double dt = MAX(1, effective_time) / 1000.0;
-  double it = ctx->k_checked / dt / 1000000;
+  size_t k_checked = ctx_k_checked(ctx);
+  double it = k_checked / dt / 1000000;
   term_clear_line();
   fprintf(stderr, "%.2fs ~ %.2f Mkeys/s ~ %'zu / %'zu%s%c", //
-          dt, it, ctx->k_found, ctx->k_checked, msg, ctx->finished ? '\n' : '\r');
+          dt, it, ctx->k_found, k_checked, msg, ctx->finished ? '\n' : '\r');
   fflush(stderr);
 }
 
@@ -155,26 +218,65 @@ void ctx_check_paused(ctx_t *ctx) {
   }
 }
 
-void ctx_update(ctx_t *ctx, size_t k_checked) {
-  size_t ts = tsnow();
+void ctx_update(worker_t *worker, size_t k_checked) {
+  // only owner writes own counters, so plain relaxed stores are enough (printing in reporter)
+  size_t k = atomic_load_explicit(&worker->k_checked, memory_order_relaxed);
+  atomic_store_explicit(&worker->k_checked, k + k_checked, memory_order_relaxed);
+  atomic_store_explicit(&worker->ts_updated, tsnow(), memory_order_relaxed);
 
-  pthread_mutex_lock(&ctx->lock);
-  bool need_print = (ts - ctx->ts_printed) >= 100;
-  ctx->k_checked += k_checked;
-  ctx->ts_updated = ts;
-  if (need_print) {
-    ctx->ts_printed = ts;
-    ctx_print_unlocked(ctx);
+  ctx_check_paused(worker->ctx);
+}
+
+void *worker_scratch(worker_t *worker, size_t size) {
+  if (worker->scratch_size < size) {
+    free(worker->scratch);
+    worker->scratch = aligned_alloc(64, (size + 63) / 64 * 64);
+    worker->scratch_size = size;
   }
-  pthread_mutex_unlock(&ctx->lock);
 
-  ctx_check_paused(ctx);
+  return worker->scratch;
+}
+
+void *ctx_reporter(void *arg) {
+  ctx_t *ctx = (ctx_t *)arg;
+  while (!atomic_load(&ctx->reporter_stop)) {
+    usleep(STATUS_INTERVAL_MS * 1000);
+    if (!ctx->paused) ctx_print_status(ctx);
+  }
+
+  return NULL;
+}
+
+void ctx_start_reporter(ctx_t *ctx) {
+  atomic_store(&ctx->reporter_stop, false);
+  pthread_create(&ctx->reporter, NULL, ctx_reporter, ctx);
+}
+
+void ctx_print_stages(ctx_t *ctx) {
+  // how many hashes each filter stage rejects (of those that reached it)
+  size_t k[4] = {0};
+  for (size_t i = 0; i < ctx->threads_count; ++i) {
+    for (size_t j = 0; j < 4; ++j) k[j] += ctx->workers[i].k_stages[j];
+  }
+
+  const char *names[3] = {"prefilter", "bloom", "list"};
+  size_t stages = ctx->hidx.hashes != NULL ? 3 : 2;
+  fprintf(stderr, "filter stages: %'zu hashes", k[0]);
+  for (size_t j = 0; j < stages; ++j) {
+    double rejected = k[j] ? 100.0 * (k[j] - k[j + 1]) / k[j] : 0.0;
+    fprintf(stderr, " ~ %s: %.3f%% rejected", names[j], rejected);
+  }
+  fprintf(stderr, "\n");
 }
 
 void ctx_finish(ctx_t *ctx) {
+  atomic_store(&ctx->reporter_stop, true);
+  pthread_join(ctx->reporter, NULL);
+
   pthread_mutex_lock(&ctx->lock);
   ctx->finished = true;
   ctx_print_unlocked(ctx);
+  if (ctx->pf.bits != NULL) ctx_print_stages(ctx);
   if (ctx->outfile != NULL) fclose(ctx->outfile);
   pthread_mutex_unlock(&ctx->lock);
 }
@@ -202,18 +304,58 @@ void ctx_write_found(ctx_t *ctx, const char *label, const h160_t hash, const fe
   pthread_mutex_unlock(&ctx->lock);
 }
 
-bool ctx_check_hash(ctx_t *ctx, const h160_t h) {
-  // bloom filter only mode
-  if (ctx->to_find_hashes == NULL) {
-    return blf_has(&ctx->blf, h);
+u32 _ctx_check_filter(ctx_t *ctx, size_t *stages, const h160x_t hs, size_t n) {
+  u32 mask;
+  if (ctx->fuse.fps != NULL) {
+    fuse_has_batch(&ctx->fuse, hs, n, &mask);
+    stages[2] += __builtin_popcount(mask);
+    return mask;
+  }
+
+  blf_has_batch(&ctx->blf, hs, n, &mask);
+  stages[2] += __builtin_popcount(mask);
+  if (ctx->hidx.hashes == NULL || mask == 0) return mask;
+
+  h160_t h;
+  for (size_t j = 0; j < n; ++j) {
+    if (!(mask & (1u << j))) continue;
+    h160x_get(h, hs, j);
+    if (hidx_has(&ctx->hidx, h)) continue;
+    mask &= ~(1u << j);
+  }
+
+  stages[3] += __builtin_popcount(mask);
+  return mask;
+}
+
+u32 ctx_check_hashes(worker_t *worker, const h160x_t hs, size_t n) {
+  // checks hashes against prefilter and filter, bit j of result is set if lane j matched
+  ctx_t *ctx = worker->ctx;
+  size_t *stages = worker->k_stages;
+  stages[0] += n;
+  if (ctx->pf.bits == NULL) {
+    stages[1] += n;
+    return _ctx_check_filter(ctx, stages, hs, n);
   }
 
-  // check by hashes list
-  if (!blf_has(&ctx->blf, h)) return false; // fast check with bloom filter
+  u32 pm;
+  blf_has_batch(&ctx->pf, hs, n, &pm);
+  stages[1] += __builtin_popcount(pm);
+  if (pm == 0) return 0;
+
+  // only lanes passed prefilter go to the main filter, packed to the front of batch
+  h160x_t ps;
+  u8 lanes[HASH_BATCH_SIZE];
+  size_t pn = 0;
+  for (size_t j = 0; j < n; ++j) {
+    if (!(pm & (1u << j))) continue;
+    for (size_t k = 0; k < 5; ++k) ps[k][pn] = hs[k][j];
+    lanes[pn++] = j;
+  }
 
-  // if bloom filter check passed, do full check
-  h160_t *rs = bsearch(h, ctx->to_find_hashes, ctx->to_find_count, sizeof(h160_t), compare_160);
-  return rs != NULL;
+  u32 mask = 0, fm = _ctx_check_filter(ctx, stages, ps, pn);
+  for (size_t i = 0; i < pn; ++i) mask |= ((fm >> i) & 1) << lanes[i];
+  return mask;
 }
 
 void ctx_precompute_gpoints(ctx_t *ctx) {
@@ -222,26 +364,31 @@ void ctx_precompute_gpoints(ctx_t *ctx) {
   fe_shiftl(ctx->stride_k, ctx->ord_offs);
 
   fe t; // precalc stride point
-  fe_modn_add_stride(t, FE_ZERO, ctx->stride_k, GROUP_INV_SIZE);
-  ec_jacobi_mulrdc(&ctx->stride_p, &G1, t); // G * (GROUP_INV_SIZE * gs)
+  fe_modn_add_stride(t, FE_ZERO, ctx->stride_k, ctx->group_size);
+  ec_jacobi_mulrdc(&ctx->stride_p, &G1, t); // G * (group_size * gs)
 
   pe g1, g2;
   ec_jacobi_mulrdc(&g1, &G1, ctx->stride_k);
   ec_jacobi_dblrdc(&g2, &g1);
 
-  size_t hsize = GROUP_INV_SIZE / 2;
+  size_t hsize = ctx->group_size / 2;
+  ctx->gpoints_x = realloc(ctx->gpoints_x, ctx->group_size * sizeof(fe));
+  ctx->gpoints_y = realloc(ctx->gpoints_y, ctx->group_size * sizeof(fe));
 
   // K+1, K+2, .., K+N/2-1
-  pe_clone(ctx->gpoints + 0, &g1);
-  pe_clone(ctx->gpoints + 1, &g2);
-  for (size_t i = 2; i < hsize; ++i) {
-    ec_jacobi_addrdc(ctx->gpoints + i, ctx->gpoints + i - 1, &g1);
+  pe gp;
+  pe_clone(&gp, &g1);
+  for (size_t i = 0; i < hsize; ++i) {
+    if (i == 1) pe_clone(&gp, &g2);
+    if (i >= 2) ec_jacobi_addrdc(&gp, &gp, &g1);
+    fe_clone(ctx->gpoints_x[i], gp.x);
+    fe_clone(ctx->gpoints_y[i], gp.y);
   }
 
   // K-1, K-2, .., K-N/2
   for (size_t i = 0; i < hsize; ++i) {
-    pe_clone(&ctx->gpoints[hsize + i], &ctx->gpoints[i]);
-    fe_modp_neg(ctx->gpoints[hsize + i].y, ctx->gpoints[i].y); // y = -y
+    fe_clone(ctx->gpoints_x[hsize + i], ctx->gpoints_x[i]);
+    fe_modp_neg(ctx->gpoints_y[hsize + i], ctx->gpoints_y[i]); // y = -y
   }
 }
 
@@ -275,8 +422,11 @@ void calc_priv(fe pk, const fe start_pk, const fe stride_k, size_t pk_off, u8 en
   if (endo == 5) fe_modn_neg(pk, pk);
 }
 
-void check_hash(ctx_t *ctx, bool c, const h160_t h, const fe start_pk, u64 pk_off, size_t endo) {
-  if (!ctx_check_hash(ctx, h)) return;
+void found_hash(ctx_t *ctx, bool c, const h160x_t hs, size_t lane, const fe start_pk, u64 pk_off,
+                size_t endo) {
+  // lane already matched by ctx_check_hashes, recover private key, verify and report it
+  h160_t h;
+  h160x_get(h, hs, lane);
 
   fe ck;
   calc_priv(ck, start_pk, ctx->stride_k, pk_off, endo);
@@ -284,16 +434,24 @@ void check_hash(ctx_t *ctx, bool c, const h160_t h, const fe start_pk, u64 pk_of
   ctx_write_found(ctx, c ? "addr33" : "addr65", h, ck);
 }
 
-void check_found_add(ctx_t *ctx, fe const start_pk, const pe *points) {
-  h160_t hs33[HASH_BATCH_SIZE];
-  h160_t hs65[HASH_BATCH_SIZE];
+void check_found_add(worker_t *worker, fe const start_pk, const fe *xs, const fe *ys,
+                     const u8 *odd) {
+  // x-only mode (see batch_add): ys is NULL, odd has parity of y for each point
+  ctx_t *ctx = worker->ctx;
+  h160x_t hs33, hs65;
+  u32 m33 = 0, m65 = 0;
+
+  for (size_t i = 0; i < ctx->group_size; i += HASH_BATCH_SIZE) {
+    if (odd != NULL) addr33_batch_xp(hs33, xs + i, odd + i, HASH_BATCH_SIZE);
+    else if (ctx->check_addr33) addr33_batch(hs33, xs + i, ys + i, HASH_BATCH_SIZE);
+    if (ctx->check_addr65) addr65_batch(hs65, xs + i, ys + i, HASH_BATCH_SIZE);
+    if (ctx->check_addr33) m33 = ctx_check_hashes(worker, hs33, HASH_BATCH_SIZE);
+    if (ctx->check_addr65) m65 = ctx_check_hashes(worker, hs65, HASH_BATCH_SIZE);
+    if (!(m33 | m65)) continue;
 
-  for (size_t i = 0; i < GROUP_INV_SIZE; i += HASH_BATCH_SIZE) {
-    if (ctx->check_addr33) addr33_batch(hs33, points + i, HASH_BATCH_SIZE);
-    if (ctx->check_addr65) addr65_batch(hs65, points + i, HASH_BATCH_SIZE);
     for (size_t j = 0; j < HASH_BATCH_SIZE; ++j) {
-      if (ctx->check_addr33) check_hash(ctx, true, hs33[j], start_pk, i + j, 0);
-      if (ctx->check_addr65) check_hash(ctx, false, hs65[j], start_pk, i + j, 0);
+      if (m33 & (1u << j)) found_hash(ctx, true, hs33, j, start_pk, i + j, 0);
+      if (m65 & (1u << j)) found_hash(ctx, false, hs65, j, start_pk, i + j, 0);
     }
   }
 
@@ -304,56 +462,70 @@ void check_found_add(ctx_t *ctx, fe const start_pk, const pe *points) {
   // PrivKeys = (pk) (!pk) (pk*alpha) !(pk*alpha) (pk*alpha^2) !(pk*alpha^2)
 
   size_t esize = HASH_BATCH_SIZE * 5;
-  pe endos[esize];
-  for (size_t i = 0; i < esize; ++i) fe_set64(endos[i].z, 1);
+  fe ex[esize], ey[esize];
 
   size_t ci = 0;
-  for (size_t k = 0; k < GROUP_INV_SIZE; ++k) {
+  for (size_t k = 0; k < ctx->group_size; ++k) {
     size_t idx = (k * 5) % esize;
 
-    fe_clone(endos[idx + 0].x, points[k].x); // (x, -y)
-    fe_modp_neg(endos[idx + 0].y, points[k].y);
+    fe_clone(ex[idx + 0], xs[k]); // (x, -y)
+    fe_modp_neg(ey[idx + 0], ys[k]);
 
-    fe_modp_mul(endos[idx + 1].x, points[k].x, B1); // (x * beta, y)
-    fe_clone(endos[idx + 1].y, points[k].y);
+    fe_modp_mul(ex[idx + 1], xs[k], B1); // (x * beta, y)
+    fe_clone(ey[idx + 1], ys[k]);
 
-    fe_clone(endos[idx + 2].x, endos[idx + 1].x); // (x * beta, -y)
-    fe_clone(endos[idx + 2].y, endos[idx + 0].y);
+    fe_clone(ex[idx + 2], ex[idx + 1]); // (x * beta, -y)
+    fe_clone(ey[idx + 2], ey[idx + 0]);
 
-    fe_modp_mul(endos[idx + 3].x, points[k].x, B2); // (x * beta^2, y)
-    fe_clone(endos[idx + 3].y, points[k].y);
+    fe_modp_mul(ex[idx + 3], xs[k], B2); // (x * beta^2, y)
+    fe_clone(ey[idx + 3], ys[k]);
 
-    fe_clone(endos[idx + 4].x, endos[idx + 3].x); // (x * beta^2, -y)
-    fe_clone(endos[idx + 4].y, endos[idx + 0].y);
+    fe_clone(ex[idx + 4], ex[idx + 3]); // (x * beta^2, -y)
+    fe_clone(ey[idx + 4], ey[idx + 0]);
 
-    bool is_full = (idx + 5) % esize == 0 || k == GROUP_INV_SIZE - 1;
+    bool is_full = (idx + 5) % esize == 0 || k == ctx->group_size - 1;
     if (!is_full) continue;
 
     for (size_t i = 0; i < esize; i += HASH_BATCH_SIZE) {
-      if (ctx->check_addr33) addr33_batch(hs33, endos + i, HASH_BATCH_SIZE);
-      if (ctx->check_addr65) addr65_batch(hs65, endos + i, HASH_BATCH_SIZE);
+      if (ctx->check_addr33) addr33_batch(hs33, ex + i, ey + i, HASH_BATCH_SIZE);
+      if (ctx->check_addr65) addr65_batch(hs65, ex + i, ey + i, HASH_BATCH_SIZE);
+      if (ctx->check_addr33) m33 = ctx_check_hashes(worker, hs33, HASH_BATCH_SIZE);
+      if (ctx->check_addr65) m65 = ctx_check_hashes(worker, hs65, HASH_BATCH_SIZE);
 
       for (size_t j = 0; j < HASH_BATCH_SIZE; ++j) {
-        // if (ci >= (GROUP_INV_SIZE * 5)) break;
+        // if (ci >= (ctx->group_size * 5)) break;
         // printf(">> %6zu | %6zu ~ %zu\n", ci, ci / 5, (ci % 5) + 1);
-        if (ctx->check_addr33) check_hash(ctx, true, hs33[j], start_pk, ci / 5, (ci % 5) + 1);
-        if (ctx->check_addr65) check_hash(ctx, false, hs65[j], start_pk, ci / 5, (ci % 5) + 1);
+        if (m33 & (1u << j)) found_hash(ctx, true, hs33, j, start_pk, ci / 5, (ci % 5) + 1);
+        if (m65 & (1u << j)) found_hash(ctx, false, hs65, j, start_pk, ci / 5, (ci % 5) + 1);
         ci += 1;
       }
     }
   }
 
-  assert(ci == GROUP_INV_SIZE * 5);
+  assert(ci == ctx->group_size * 5);
+}
+
+size_t batch_add_scratch_size(size_t gsize) {
+  // bx, by (gsize each), dx and grpinv scratch (gsize / 2 each), y parity bytes
+  return 3 * gsize * sizeof(fe) + gsize;
 }
 
-void batch_add(ctx_t *ctx, const fe pk, const size_t iterations) {
-  size_t hsize = GROUP_INV_SIZE / 2;
+void batch_add(worker_t *worker, const fe pk, const size_t iterations) {
+  ctx_t *ctx = worker->ctx;
+  size_t gsize = ctx->group_size, hsize = gsize / 2;
 
-  pe bp[GROUP_INV_SIZE]; // calculated ec points
-  fe dx[hsize];          // delta x for group inversion
-  pe GStart;             // iteration points
-  fe ck, rx, ry;         // current start point; tmp for x3, y3
-  fe ss, dd;             // temp variables
+  // only addr33 needs just x and parity of y, so y is not stored (~1/2 less memory traffic);
+  // endo needs full y for its points
+  bool xonly = ctx->check_addr33 && !ctx->check_addr65 && !ctx->use_endo;
+
+  fe *bx = worker_scratch(worker, batch_add_scratch_size(gsize)); // ec points x (affine, SoA)
+  fe *by = bx + gsize;                                            // ec points y
+  fe *dx = by + gsize;                                            // delta x for group inversion
+  fe *zs = dx + hsize;                                            // group inversion scratch
+  u8 *bp = (u8 *)(zs + hsize);                                    // parity of y (x-only mode)
+  pe GStart;                                                      // iteration points
+  fe ck, rx, ry;                                                  // current pk; tmp for x3, y3
+  fe ss, dd;                                                      // temp variables
 
   // set start point to center of the group
   fe_modn_add_stride(ss, pk, ctx->stride_k, hsize);
@@ -361,26 +533,53 @@ void batch_add(ctx_t *ctx, const fe pk, const size_t iterations) {
 
   // group addition with single inversion (with stride support)
   // structure: K-N/2 .. K-2 K-1 [K] K+1 K+2 .. K+N/2-1 (last K dropped to have odd size)
-  // points in `bp` already order by `pk` increment
+  // points in `bx` / `by` already order by `pk` increment
   fe_clone(ck, pk); // start pk for current iteration
 
   size_t counter = 0;
   while (counter < iterations) {
-    for (size_t i = 0; i < hsize; ++i) fe_modp_sub(dx[i], ctx->gpoints[i].x, GStart.x);
-    fe_modp_grpinv(dx, hsize);
+    for (size_t i = 0; i < hsize; ++i) fe_modp_sub(dx[i], ctx->gpoints_x[i], GStart.x);
+    fe_modp_grpinv(dx, hsize, zs);
 
-    pe_clone(&bp[hsize + 0], &GStart); // set K value
+    fe_clone(bx[hsize + 0], GStart.x); // set K value
+    if (xonly) bp[hsize + 0] = GStart.y[0] & 1;
+    else fe_clone(by[hsize + 0], GStart.y);
 
     for (size_t D = 0; D < 2; ++D) {
       bool positive = D == 0;
       size_t g_idx = positive ? 0 : hsize; // plus points in first half, minus in second half
       size_t g_max = positive ? hsize - 1 : hsize; // skip K+N/2, since we don't need it
-      for (size_t i = 0; i < g_max; ++i) {
-        fe_modp_sub(ss, ctx->gpoints[g_idx + i].y, GStart.y); // y2 - y1
+      size_t i = 0;
+
+#if FE_LANES > 1
+      // vectorized path: FE_LANES points per step, tail handled by scalar loop below
+      fe vx[FE_LANES], vy[FE_LANES];
+      for (; i + FE_LANES <= g_max; i += FE_LANES) {
+        const fe *x2 = ctx->gpoints_x + g_idx + i, *y2 = ctx->gpoints_y + g_idx + i;
+        if (positive) {
+          fe *ty = xonly ? vy : by + hsize + 1 + i;
+          ec_affine_add_lanes(bx + hsize + 1 + i, ty, GStart.x, GStart.y, x2, y2, dx + i);
+          if (xonly) {
+            for (size_t j = 0; j < FE_LANES; ++j) bp[hsize + 1 + i + j] = vy[j][0] & 1;
+          }
+          continue;
+        }
+
+        ec_affine_add_lanes(vx, vy, GStart.x, GStart.y, x2, y2, dx + i);
+        for (size_t j = 0; j < FE_LANES; ++j) {
+          fe_clone(bx[hsize - 1 - i - j], vx[j]);
+          if (xonly) bp[hsize - 1 - i - j] = vy[j][0] & 1;
+          else fe_clone(by[hsize - 1 - i - j], vy[j]);
+        }
+      }
+#endif
+
+      for (; i < g_max; ++i) {
+        fe_modp_sub(ss, ctx->gpoints_y[g_idx + i], GStart.y); // y2 - y1
         fe_modp_mul(ss, ss, dx[i]);                           // λ = (y2 - y1) / (x2 - x1)
         fe_modp_sqr(rx, ss);                                  // λ²
         fe_modp_sub(rx, rx, GStart.x);                        // λ² - x1
-        fe_modp_sub(rx, rx, ctx->gpoints[g_idx + i].x);       // rx = λ² - x1 - x2
+        fe_modp_sub(rx, rx, ctx->gpoints_x[g_idx + i]);       // rx = λ² - x1 - x2
         fe_modp_sub(dd, GStart.x, rx);                        // x1 - rx
         fe_modp_mul(dd, ss, dd);                              // λ * (x1 - rx)
         fe_modp_sub(ry, dd, GStart.y);                        // ry = λ * (x1 - rx) - y1
@@ -389,24 +588,42 @@ void batch_add(ctx_t *ctx, const fe pk, const size_t iterations) {
         // [0]: K-N/2, [1]: K-N/2+1, .., [N/2-1]: K-1 // all minus points
         // [N/2]: K, [N/2+1]: K+1, .., [N-1]: K+N/2-1 // K, plus points without last element
         size_t idx = positive ? hsize + i + 1 : hsize - 1 - i;
-        fe_clone(bp[idx].x, rx);
-        fe_clone(bp[idx].y, ry);
-        fe_set64(bp[idx].z, 0x1);
+        fe_clone(bx[idx], rx);
+        if (xonly) bp[idx] = ry[0] & 1;
+        else fe_clone(by[idx], ry);
       }
     }
 
-    check_found_add(ctx, ck, bp);
-    fe_modn_add_stride(ck, ck, ctx->stride_k, GROUP_INV_SIZE); // move pk to next group START
-    ec_jacobi_addrdc(&GStart, &GStart, &ctx->stride_p);        // move GStart to next group CENTER
-    counter += GROUP_INV_SIZE;
+    check_found_add(worker, ck, bx, xonly ? NULL : by, xonly ? bp : NULL);
+    fe_modn_add_stride(ck, ck, ctx->stride_k, gsize);   // move pk to next group START
+    ec_jacobi_addrdc(&GStart, &GStart, &ctx->stride_p); // move GStart to next group CENTER
+    counter += gsize;
   }
 }
 
-void *cmd_add_worker(void *arg) {
-  ctx_t *ctx = (ctx_t *)arg;
+void ctx_reset_jobs(ctx_t *ctx) {
+  // jobs count = ceil((range_e - range_s) / (job_size * 2^offset))
+  fe t;
+  fe_modn_sub(t, ctx->range_e, ctx->range_s);
+
+  bool rem = false;
+  for (u32 n = ctx->ord_offs; n > 0;) {
+    u8 s = MIN(n, 63u);
+    rem = rem || (t[0] & ((1ULL << s) - 1)) != 0;
+    fe_shiftr64(t, s);
+    n -= s;
+  }
+
+  if (rem) fe_add64(t, 1);
+  if (t[1] || t[2] || t[3]) ctx->job_count = UINT64_MAX; // practically endless
+  else ctx->job_count = t[0] / ctx->job_size + (t[0] % ctx->job_size != 0);
+
+  atomic_store(&ctx->job_next, 0);
+}
 
-  fe initial_r; // keep initial range start to check overflow
-  fe_clone(initial_r, ctx->range_s);
+void *cmd_add_worker(void *arg) {
+  worker_t *worker = (worker_t *)arg;
+  ctx_t *ctx = worker->ctx;
 
   // job_size multiply by 2^offset (iterate over desired digit order)
   // for example: 3013 3023 .. 30X3 .. 3093 3103 3113
@@ -416,19 +633,13 @@ void *cmd_add_worker(void *arg) {
 
   fe pk;
   while (true) {
-    pthread_mutex_lock(&ctx->lock);
-    bool is_overflow = fe_cmp(ctx->range_s, initial_r) < 0;
-    if (fe_cmp(ctx->range_s, ctx->range_e) >= 0 || is_overflow) {
-      pthread_mutex_unlock(&ctx->lock);
-      break;
-    }
+    // jobs are taken by index, so workers never wait for each other
+    u64 job = atomic_fetch_add_explicit(&ctx->job_next, 1, memory_order_relaxed);
+    if (job >= ctx->job_count) break;
 
-    fe_clone(pk, ctx->range_s);
-    fe_modn_add(ctx->range_s, ctx->range_s, inc);
-    pthread_mutex_unlock(&ctx->lock);
-
-    batch_add(ctx, pk, ctx->job_size);
-    ctx_update(ctx, ctx->use_endo ? ctx->job_size * 6 : ctx->job_size);
+    fe_modn_add_stride(pk, ctx->range_s, inc, job);
+    batch_add(worker, pk, ctx->job_size);
+    ctx_update(worker, ctx->use_endo ? ctx->job_size * 6 : ctx->job_size);
   }
 
   return NULL;
@@ -440,14 +651,16 @@ void cmd_add(ctx_t *ctx) {
   fe range_size;
   fe_modn_sub(range_size, ctx->range_e, ctx->range_s);
   ctx->job_size = fe_cmp64(range_size, MAX_JOB_SIZE) < 0 ? range_size[0] : MAX_JOB_SIZE;
+  ctx_reset_jobs(ctx);
   ctx->ts_started = tsnow(); // actual start time
+  ctx_start_reporter(ctx);
 
   for (size_t i = 0; i < ctx->threads_count; ++i) {
-    pthread_create(&ctx->threads[i], NULL, cmd_add_worker, ctx);
+    pthread_create(&ctx->workers[i].thread, NULL, cmd_add_worker, &ctx->workers[i]);
   }
 
   for (size_t i = 0; i < ctx->threads_count; ++i) {
-    pthread_join(ctx->threads[i], NULL);
+    pthread_join(ctx->workers[i].thread, NULL);
   }
 
   ctx_finish(ctx);
@@ -455,68 +668,179 @@ void cmd_add(ctx_t *ctx) {
 
 // MARK: CMD_MUL
 
-void check_found_mul(ctx_t *ctx, const fe *pk, const pe *cp, size_t cnt) {
-  h160_t hs33[HASH_BATCH_SIZE];
-  h160_t hs65[HASH_BATCH_SIZE];
+void check_found_mul(worker_t *worker, const fe *pk, const pe *cp, size_t cnt) {
+  ctx_t *ctx = worker->ctx;
+  h160x_t hs33, hs65;
+  fe xs[HASH_BATCH_SIZE], ys[HASH_BATCH_SIZE];
+  u32 m33 = 0, m65 = 0;
+  h160_t h;
 
   for (size_t i = 0; i < cnt; i += HASH_BATCH_SIZE) {
     size_t batch_size = MIN(HASH_BATCH_SIZE, cnt - i);
-    if (ctx->check_addr33) addr33_batch(hs33, cp + i, batch_size);
-    if (ctx->check_addr65) addr65_batch(hs65, cp + i, batch_size);
+    for (size_t j = 0; j < batch_size; ++j) {
+      fe_clone(xs[j], cp[i + j].x);
+      fe_clone(ys[j], cp[i + j].y);
+    }
 
-    for (size_t j = 0; j < HASH_BATCH_SIZE; ++j) {
-      if (ctx->check_addr33 && ctx_check_hash(ctx, hs33[j])) {
-        // pk_verify_hash(pk[i + j], hs33[j], true, 0);
-        ctx_write_found(ctx, "addr33", hs33[j], pk[i + j]);
+    if (ctx->check_addr33) addr33_batch(hs33, xs, ys, batch_size);
+    if (ctx->check_addr65) addr65_batch(hs65, xs, ys, batch_size);
+
+    if (ctx->check_addr33) m33 = ctx_check_hashes(worker, hs33, batch_size);
+    if (ctx->check_addr65) m65 = ctx_check_hashes(worker, hs65, batch_size);
+    if (!(m33 | m65)) continue;
+
+    for (size_t j = 0; j < batch_size; ++j) {
+      if (m33 & (1u << j)) {
+        h160x_get(h, hs33, j);
+        // pk_verify_hash(pk[i + j], h, true, 0);
+        ctx_write_found(ctx, "addr33", h, pk[i + j]);
       }
 
-      if (ctx->check_addr65 && ctx_check_hash(ctx, hs65[j])) {
-        // pk_verify_hash(pk[i + j], hs65[j], false, 0);
-        ctx_write_found(ctx, "addr65", hs65[j], pk[i + j]);
+      if (m65 & (1u << j)) {
+        h160x_get(h, hs65, j);
+        // pk_verify_hash(pk[i + j], h, false, 0);
+        ctx_write_found(ctx, "addr65", h, pk[i + j]);
       }
     }
   }
 }
 
+// stdin is read straight into job data and lines are used in place (by offset & length), so
+// only used part of it is touched; jobs are allocated once and go around:
+// pool -> reader -> queue -> worker -> pool
 typedef struct cmd_mul_job_t {
   size_t count;
-  char lines[GROUP_INV_SIZE][MAX_LINE_SIZE];
+  size_t size; // bytes in data
+  size_t cap;  // max lines / keys (group size)
+  u32 *offs;   // line start in data (text input)
+  u16 *lens;   // line length (without newline)
+  char *data;  // cap * MAX_LINE_SIZE bytes
 } cmd_mul_job_t;
 
+cmd_mul_job_t *cmd_mul_job_new(size_t cap) {
+  // one allocation: header, offs, lens, data
+  size_t head = sizeof(cmd_mul_job_t), offs = cap * sizeof(u32), lens = cap * sizeof(u16);
+  cmd_mul_job_t *job = malloc(head + offs + lens + cap * MAX_LINE_SIZE);
+  job->cap = cap;
+  job->offs = (u32 *)((u8 *)job + head);
+  job->lens = (u16 *)((u8 *)job->offs + offs);
+  job->data = (char *)job->lens + lens;
+  return job;
+}
+
+typedef struct cmd_mul_reader_t {
+  int fd;
+  bool eof;
+  size_t pos;      // bytes of current job data already taken into lines / keys
+  size_t line_avg; // average line size, to read about as much as job needs
+} cmd_mul_reader_t;
+
+void _cmd_mul_read(cmd_mul_reader_t *r, cmd_mul_job_t *job, size_t want) {
+  while (true) {
+    ssize_t k = read(r->fd, job->data + job->size, want);
+    if (k < 0 && errno == EINTR) continue;
+    if (k <= 0) r->eof = true;
+    else job->size += k;
+    return;
+  }
+}
+
+void cmd_mul_fill_text(cmd_mul_reader_t *r, cmd_mul_job_t *job) {
+  // fills job up to job->cap lines or eof; same lines as fgets with MAX_LINE_SIZE buffer
+  // would give (longer lines are split); unfinished line stays at the end of data after r->pos
+  const size_t cap = job->cap * MAX_LINE_SIZE, max_len = MAX_LINE_SIZE - 1;
+
+  while (job->count < job->cap) {
+    char *line = job->data + r->pos;
+    size_t left = job->size - r->pos, len = 0;
+    char *nl = memchr(line, '\n', MIN(left, max_len + 1));
+
+    if (nl != NULL) {
+      len = nl - line;
+      r->pos += len + 1;
+    } else if (left > max_len || (r->eof && left > 0)) {
+      len = MIN(left, max_len);
+      r->pos += len;
+    } else if (r->eof) {
+      break;
+    } else {
+      // no full line in buffer: drop consumed bytes if possible, or send what is collected
+      if (job->count == 0 && r->pos > 0) {
+        memmove(job->data, line, left);
+        job->size = left, r->pos = 0;
+      }
+
+      if (job->size == cap) break;
+      size_t want = (job->cap - job->count) * r->line_avg + 4096;
+      _cmd_mul_read(r, job, MIN(want, cap - job->size));
+      continue;
+    }
+
+    if (len > 0 && line[len - 1] == '\r') len -= 1;
+    if (len == 0) continue;
+
+    job->offs[job->count] = line - job->data;
+    job->lens[job->count] = len;
+    job->count += 1;
+  }
+}
+
+void cmd_mul_fill_bin(cmd_mul_reader_t *r, cmd_mul_job_t *job) {
+  // 32 byte big-endian keys, one after another
+  const size_t want = job->cap * sizeof(fe);
+  while (!r->eof && job->size < want) _cmd_mul_read(r, job, want - job->size);
+
+  job->count = MIN(job->size, want) / sizeof(fe);
+  r->pos = job->count * sizeof(fe);
+  if (r->eof && job->size > r->pos) {
+    fprintf(stderr, "ignored %zu trailing bytes of input\n", job->size - r->pos);
+    r->pos = job->size;
+  }
+}
+
 void *cmd_mul_worker(void *arg) {
-  ctx_t *ctx = (ctx_t *)arg;
+  worker_t *worker = (worker_t *)arg;
+  ctx_t *ctx = worker->ctx;
 
   // sha256 routine
   u8 msg[(MAX_LINE_SIZE + 63 + 9) / 64 * 64] = {0}; // 9 = 1 byte 0x80 + 8 byte bitlen
   u32 res[8] = {0};
 
-  fe pk[GROUP_INV_SIZE];
-  pe cp[GROUP_INV_SIZE];
+  size_t gsize = ctx->group_size;
+  fe *pk = worker_scratch(worker, gsize * (sizeof(fe) + sizeof(pe) + 2 * sizeof(fe)));
+  pe *cp = (pe *)(pk + gsize); // computed public keys
+  fe *zz = (fe *)(cp + gsize); // group reduce scratch
   cmd_mul_job_t *job = NULL;
 
   while (true) {
-    if (job != NULL) free(job);
+    if (job != NULL) queue_put(&ctx->pool, job);
     job = queue_get(&ctx->queue);
     if (job == NULL) break;
 
-    // parse private keys from hex string
-    if (!ctx->raw_text) {
-      for (size_t i = 0; i < job->count; ++i) fe_modn_from_hex(pk[i], job->lines[i]);
+    // parse private keys from binary or hex string
+    if (ctx->bin_input) {
+      for (size_t i = 0; i < job->count; ++i) {
+        fe_modn_from_bytes(pk[i], (u8 *)job->data + i * sizeof(fe));
+      }
+    } else if (!ctx->raw_text) {
+      for (size_t i = 0; i < job->count; ++i) {
+        fe_modn_from_hexn(pk[i], job->data + job->offs[i], job->lens[i]);
+      }
     } else {
       for (size_t i = 0; i < job->count; ++i) {
-        size_t len = strlen(job->lines[i]);
+        size_t len = job->lens[i];
         size_t msg_size = (len + 63 + 9) / 64 * 64;
 
         // calculate sha256 hash
         size_t bitlen = len * 8;
-        memcpy(msg, job->lines[i], len);
+        memcpy(msg, job->data + job->offs[i], len);
         memset(msg + len, 0, msg_size - len);
         msg[len] = 0x80;
         for (int j = 0; j < 8; j++) msg[msg_size - 1 - j] = bitlen >> (j * 8);
         sha256_final(res, (u8 *)msg, msg_size);
 
         // debug log (do with `-t 1`)
-        // printf("\n%zu %s\n", len, job->lines[i]);
+        // printf("\n%zu %.*s\n", len, (int)len, job->data + job->offs[i]);
         // for (int i = 0; i < msg_size; i++) printf("%02x%s", msg[i], i % 16 == 15 ? "\n" : " ");
         // for (int i = 0; i < 8; i++) printf("%08x%s", res[i], i % 8 == 7 ? "\n" : "");
 
@@ -529,49 +853,61 @@ void *cmd_mul_worker(void *arg) {
 
     // compute public keys in batch
     for (size_t i = 0; i < job->count; ++i) ec_gtable_mul(&cp[i], pk[i]);
-    ec_jacobi_grprdc(cp, job->count);
+    ec_jacobi_grprdc(cp, job->count, zz);
 
-    check_found_mul(ctx, pk, cp, job->count);
-    ctx_update(ctx, job->count);
+    check_found_mul(worker, pk, cp, job->count);
+    ctx_update(worker, job->count);
   }
 
-  if (job != NULL) free(job);
   return NULL;
 }
 
 void cmd_mul(ctx_t *ctx) {
   ec_gtable_init();
+  ctx_start_reporter(ctx);
 
   for (size_t i = 0; i < ctx->threads_count; ++i) {
-    pthread_create(&ctx->threads[i], NULL, cmd_mul_worker, ctx);
+    pthread_create(&ctx->workers[i].thread, NULL, cmd_mul_worker, &ctx->workers[i]);
   }
 
-  cmd_mul_job_t *job = calloc(1, sizeof(cmd_mul_job_t));
-  char line[MAX_LINE_SIZE];
+  // enough jobs for full queue, one in each worker and two in reader; reader waits for
+  // a free job when all of them are in use
+  size_t jobs_count = ctx->queue.capacity + ctx->threads_count + 2;
+  queue_init(&ctx->pool, jobs_count);
+  for (size_t i = 0; i < jobs_count; ++i) queue_put(&ctx->pool, cmd_mul_job_new(ctx->group_size));
 
-  while (fgets(line, sizeof(line), stdin) != NULL) {
-    size_t len = strlen(line);
-    if (len && line[len - 1] == '\n') line[--len] = '\0';
-    if (len && line[len - 1] == '\r') line[--len] = '\0';
-    if (len == 0) continue;
+  cmd_mul_reader_t r = {.fd = fileno(stdin), .eof = false, .pos = 0, .line_avg = 65};
+  cmd_mul_job_t *job = queue_get(&ctx->pool);
+  job->count = 0, job->size = 0;
 
-    strcpy(job->lines[job->count++], line);
-    if (job->count == GROUP_INV_SIZE) {
-      queue_put(&ctx->queue, job);
-      job = calloc(1, sizeof(cmd_mul_job_t));
-    }
-  }
+  while (true) {
+    if (ctx->bin_input) cmd_mul_fill_bin(&r, job);
+    else cmd_mul_fill_text(&r, job);
+    if (job->count == 0) break; // eof
+
+    // rest of data (unfinished line) is moved to next job
+    cmd_mul_job_t *next = queue_get(&ctx->pool);
+    next->count = 0, next->size = job->size - r.pos;
+    memcpy(next->data, job->data + r.pos, next->size);
+    r.line_avg = MAX(r.pos / job->count, 1ul);
+    r.pos = 0;
 
-  if (job->count > 0 && job->count != GROUP_INV_SIZE) {
     queue_put(&ctx->queue, job);
+    job = next;
   }
 
+  queue_put(&ctx->pool, job);
+
   queue_done(&ctx->queue);
 
   for (size_t i = 0; i < ctx->threads_count; ++i) {
-    pthread_join(ctx->threads[i], NULL);
+    pthread_join(ctx->workers[i].thread, NULL);
   }
 
+  void *free_job;
+  while (queue_try_get(&ctx->pool, &free_job)) free(free_job);
+  queue_free(&ctx->pool);
+
   ctx_finish(ctx);
 }
 
@@ -623,6 +959,7 @@ void cmd_rnd(ctx_t *ctx) {
   ctx_precompute_gpoints(ctx);
   ctx->job_size = MAX_JOB_SIZE;
   ctx->ts_started = tsnow(); // actual start time
+  ctx_start_reporter(ctx);
 
   fe range_s, range_e;
   fe_clone(range_s, ctx->range_s);
@@ -630,30 +967,36 @@ void cmd_rnd(ctx_t *ctx) {
 
   size_t last_c = 0, last_f = 0, s_time = 0;
   while (true) {
-    last_c = ctx->k_checked;
+    last_c = ctx_k_checked(ctx);
     last_f = ctx->k_found;
     s_time = tsnow();
 
     gen_random_range(ctx, range_s, range_e);
+    pthread_mutex_lock(&ctx->lock); // keep reporter from printing in between
+    term_clear_line();
     print_range_mask(ctx->range_s, ctx->ord_size, ctx->ord_offs, ctx->use_color);
     print_range_mask(ctx->range_e, ctx->ord_size, ctx->ord_offs, ctx->use_color);
-    ctx_print_status(ctx);
+    ctx_print_unlocked(ctx);
+    pthread_mutex_unlock(&ctx->lock);
 
     // if full range is used, skip break after first iteration
     bool is_full = fe_cmp(ctx->range_s, range_s) == 0 && fe_cmp(ctx->range_e, range_e) == 0;
 
+    ctx_reset_jobs(ctx);
     for (size_t i = 0; i < ctx->threads_count; ++i) {
-      pthread_create(&ctx->threads[i], NULL, cmd_add_worker, ctx);
+      pthread_create(&ctx->workers[i].thread, NULL, cmd_add_worker, &ctx->workers[i]);
     }
 
     for (size_t i = 0; i < ctx->threads_count; ++i) {
-      pthread_join(ctx->threads[i], NULL);
+      pthread_join(ctx->workers[i].thread, NULL);
     }
 
-    size_t dc = ctx->k_checked - last_c, df = ctx->k_found - last_f;
+    size_t dc = ctx_k_checked(ctx) - last_c, df = ctx->k_found - last_f;
     double dt = MAX((tsnow() - s_time), 1ul) / 1000.0;
+    pthread_mutex_lock(&ctx->lock);
     term_clear_line();
     printf("%'zu / %'zu ~ %.1fs\n\n", df, dc, dt);
+    pthread_mutex_unlock(&ctx->lock);
 
     if (is_full) break;
   }
@@ -661,12 +1004,178 @@ void cmd_rnd(ctx_t *ctx) {
   ctx_finish(ctx);
 }
 
+// MARK: group size config
+
+// autotune result is kept in small text file (one `key value` per line), so later runs pick
+// tuned group size without -g; path: $ECLOOP_CONF or ~/.ecloop.conf
+
+bool group_conf_path(char *buf, size_t len) {
+  const char *env = getenv("ECLOOP_CONF");
+  if (env != NULL && env[0]) return snprintf(buf, len, "%s", env) < (int)len;
+
+  const char *home = getenv("HOME");
+  if (home == NULL || !home[0]) return false;
+  return snprintf(buf, len, "%s/.ecloop.conf", home) < (int)len;
+}
+
+size_t group_conf_load(bool endo) {
+  char path[1024], key[32];
+  if (!group_conf_path(path, sizeof(path))) return 0;
+
+  FILE *file = fopen(path, "r");
+  if (!file) return 0;
+
+  size_t val = 0, res = 0;
+  const char *want = endo ? "group_endo" : "group";
+  while (fscanf(file, "%31s %zu", key, &val) == 2) {
+    if (strcmp(key, want) == 0) res = val;
+  }
+
+  fclose(file);
+  return res;
+}
+
+bool group_conf_save(size_t group, size_t group_endo) {
+  char path[1024];
+  if (!group_conf_path(path, sizeof(path))) return false;
+
+  size_t old = group_conf_load(false), old_endo = group_conf_load(true);
+  if (old || old_endo) {
+    printf("replacing in %s: group %zu ~ group_endo %zu\n", path, old, old_endo);
+  }
+
+  FILE *file = fopen(path, "w");
+  if (!file) return false;
+
+  fprintf(file, "group %zu\n", group);
+  fprintf(file, "group_endo %zu\n", group_endo);
+  fclose(file);
+  printf("saved to %s\n", path);
+  return true;
+}
+
+bool group_size_valid(size_t gsize) {
+  return gsize >= GROUP_INV_MIN && gsize <= GROUP_INV_MAX && gsize % HASH_BATCH_SIZE == 0;
+}
+
+bool load_group_size(ctx_t *ctx, args_t *args) {
+  // -g > config file (autotune) > default; returns true if size is set explicitly with -g
+  size_t gsize = args_uint(args, "-g", 0);
+  if (gsize != 0 && !group_size_valid(gsize)) {
+    fprintf(stderr, "invalid group size, must be %zu..%zu and divisible by %zu\n", GROUP_INV_MIN,
+            GROUP_INV_MAX, HASH_BATCH_SIZE);
+    exit(1);
+  }
+
+  bool fixed = gsize != 0;
+  if (!fixed) gsize = group_conf_load(ctx->use_endo);
+  if (!group_size_valid(gsize)) gsize = GROUP_INV_SIZE; // broken config ignored
+  ctx->group_size = gsize;
+  return fixed;
+}
+
+void fit_group_size(ctx_t *ctx) {
+  // saved group size must not reject range which is valid with default size (start above it),
+  // so it is lowered to largest valid size below range start instead
+  if (fe_cmp64(ctx->range_s, ctx->group_size) > 0) return;
+  size_t gsize = (ctx->range_s[0] - 1) / HASH_BATCH_SIZE * HASH_BATCH_SIZE;
+  ctx->group_size = MAX(gsize, GROUP_INV_SIZE);
+}
+
+// MARK: autotune
+
+void cmd_autotune(args_t *args) {
+  // times batch_add on one thread with different group sizes: larger group means fewer
+  // inversions per key, but working set (G-points + batch points + deltas) grows out of L1/L2
+  ctx_t ctx = {0};
+  ctx.workers = aligned_alloc(alignof(worker_t), sizeof(worker_t));
+  memset(ctx.workers, 0, sizeof(worker_t));
+  ctx.workers[0].ctx = &ctx;
+  ctx.threads_count = 1;
+
+  char *addr = arg_str(args, "-a");
+  ctx.check_addr33 = addr == NULL || strstr(addr, "c") != NULL;
+  ctx.check_addr65 = addr != NULL && strstr(addr, "u") != NULL;
+
+  // real filter gives more honest numbers (its lookups compete for cache too)
+  char *path = arg_str(args, "-f");
+  if (path != NULL) load_filter(&ctx, path, true); // no page faults while timing
+  else blf_init(&ctx.blf, blf_size(1000000, BLF_VERSION, BLF_IDX_FAST), BLF_VERSION, BLF_IDX_FAST);
+
+  long l1 = 0, l2 = 0;
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE)
+  l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+  l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+  printf("addr33: %d ~ addr65: %d ~ L1d: %ldK ~ L2: %ldK\n", ctx.check_addr33, ctx.check_addr65,
+         MAX(l1, 0l) / 1024, MAX(l2, 0l) / 1024);
+
+  const size_t sizes[] = {256, 512, 1024, 2048, 4096, 8192};
+  const size_t sizes_count = sizeof(sizes) / sizeof(sizes[0]);
+  const double margin = 0.03; // speeds closer than this are treated as noise
+  size_t best[2] = {GROUP_INV_SIZE, GROUP_INV_SIZE};
+  double speeds[sizes_count];
+
+  fe pk;
+  fe_set64(pk, 0);
+  pk[1] = rand64(true);
+
+  for (int endo = 0; endo < 2; ++endo) {
+    ctx.use_endo = endo;
+    size_t keys = endo ? (1 << 19) : (1 << 21); // ~same amount of hashes per run
+    double top = 0, def = 0;
+
+    printf("\n%s:\n", endo ? "endo" : "no endo");
+    for (size_t i = 0; i < sizes_count; ++i) {
+      ctx.group_size = sizes[i];
+      ctx_precompute_gpoints(&ctx);
+      batch_add(&ctx.workers[0], pk, sizes[i]); // warm up
+
+      // best of 3 to filter out noise
+      double speed = 0;
+      for (int r = 0; r < 3; ++r) {
+        size_t stime = tsnow();
+        batch_add(&ctx.workers[0], pk, keys);
+        double dt = MAX(tsnow() - stime, 1ul) / 1000.0;
+        speed = MAX(speed, keys * (endo ? 6 : 1) / dt / 1e6);
+      }
+
+      // same buffers as batch_add uses: its scratch and G-points (x and y)
+      size_t ws = batch_add_scratch_size(sizes[i]) + 2 * sizes[i] * sizeof(fe);
+      printf("  group %5zu ~ ws %5zuK ~ %.2fM keys/s\n", sizes[i], ws / 1024, speed);
+      speeds[i] = speed;
+      top = MAX(top, speed);
+      if (sizes[i] == GROUP_INV_SIZE) def = speed;
+    }
+
+    // keep default unless it is clearly slower, then take smallest size within noise of top
+    if (def >= top * (1 - margin)) continue;
+    for (size_t i = 0; i < sizes_count; ++i) {
+      if (speeds[i] < top * (1 - margin)) continue;
+      best[endo] = sizes[i];
+      break;
+    }
+  }
+
+  printf("\nbest: group %zu ~ group_endo %zu (default %zu is kept unless %.0f%% slower)\n",
+         best[0], best[1], GROUP_INV_SIZE, margin * 100);
+  printf("note: saved group size is also used as keys per job in mul\n");
+  if (!group_conf_save(best[0], best[1])) fprintf(stderr, "failed to save config\n");
+
+  free(ctx.gpoints_x);
+  free(ctx.gpoints_y);
+  free(ctx.workers[0].scratch);
+  free(ctx.workers);
+}
+
 // MARK: args helpers
 
-void arg_search_range(args_t *args, fe range_s, fe range_e) {
+void arg_search_range(args_t *args, fe range_s, fe range_e, size_t gsize, size_t min_s) {
+  // start must be above group size, so group points never collide with start point; min_s is
+  // group size if set with -g, otherwise default one (saved size is fitted to range later)
   char *raw = arg_str(args, "-r");
   if (!raw) {
-    fe_set64(range_s, GROUP_INV_SIZE);
+    fe_set64(range_s, gsize);
     fe_clone(range_e, FE_P);
     return;
   }
@@ -681,11 +1190,11 @@ void arg_search_range(args_t *args, fe range_s, fe range_e) {
   fe_modn_from_hex(range_s, raw);
   fe_modn_from_hex(range_e, sep + 1);
 
-  // if (fe_cmp64(range_s, GROUP_INV_SIZE) <= 0) fe_set64(range_s, GROUP_INV_SIZE + 1);
+  // if (fe_cmp64(range_s, min_s) <= 0) fe_set64(range_s, min_s + 1);
   // if (fe_cmp(range_e, FE_P) > 0) fe_clone(range_e, FE_P);
 
-  if (fe_cmp64(range_s, GROUP_INV_SIZE) <= 0) {
-    fprintf(stderr, "invalid search range, start <= %#lx\n", GROUP_INV_SIZE);
+  if (fe_cmp64(range_s, min_s) <= 0) {
+    fprintf(stderr, "invalid search range, start <= %#lx\n", min_s);
     exit(1);
   }
 
@@ -755,7 +1264,7 @@ void usage(const char *name) {
   printf("  mul             - search hex encoded private keys (from stdin)\n");
   printf("  rnd             - search random range of bits in given range\n");
   printf("\nCompute options:\n");
-  printf("  -f <file>       - filter file to search (list of hashes or bloom fitler)\n");
+  printf("  -f <file>       - filter file to search (list of hashes, bloom or fuse filter)\n");
   printf("  -o <file>       - output file to write found keys (default: stdout)\n");
   printf("  -t <threads>    - number of threads to run (default: 1)\n");
   printf("  -a <addr_type>  - address type to search: c - addr33, u - addr65 (default: c)\n");
@@ -763,11 +1272,17 @@ void usage(const char *name) {
   printf("  -d <offs:size>  - bit offset and size for search (example: 128:32, default: 0:32)\n");
   printf("  -q              - quiet mode (no output to stdout; -o required)\n");
   printf("  -endo           - use endomorphism (default: false)\n");
+  printf("  -pf <size>      - small prefilter in KB checked before filter (default: off)\n");
+  printf("  -preload        - read whole filter file at start (default: on first access)\n");
+  printf("  -g <size>       - points per group inversion (default: %zu or autotune result)\n",
+         GROUP_INV_SIZE);
   printf("\nOther commands:\n");
   printf("  blf-gen         - create bloom filter from list of hex-encoded hash160\n");
   printf("  blf-check       - check bloom filter for given hex-encoded hash160\n");
+  printf("  fuse-gen        - create binary fuse filter from list of hex-encoded hash160\n");
   printf("  bench           - run benchmark of internal functions\n");
   printf("  bench-gtable    - run benchmark of ecc multiplication (with different table size)\n");
+  printf("  autotune        - find best group size for this cpu and save it to ~/.ecloop.conf\n");
   printf("\n");
 }
 
@@ -776,9 +1291,11 @@ void init(ctx_t *ctx, args_t *args) {
   if (args->argc > 1) {
     if (strcmp(args->argv[1], "blf-gen") == 0) return blf_gen(args);
     if (strcmp(args->argv[1], "blf-check") == 0) return blf_check(args);
+    if (strcmp(args->argv[1], "fuse-gen") == 0) return fuse_gen(args);
     if (strcmp(args->argv[1], "bench") == 0) return run_bench();
     if (strcmp(args->argv[1], "bench-gtable") == 0) return run_bench_gtable();
     if (strcmp(args->argv[1], "mult-verify") == 0) return mult_verify();
+    if (strcmp(args->argv[1], "autotune") == 0) return cmd_autotune(args);
   }
 
   ctx->use_color = isatty(fileno(stdout));
@@ -805,7 +1322,8 @@ void init(ctx_t *ctx, args_t *args) {
   }
 
   char *path = arg_str(args, "-f");
-  load_filter(ctx, path);
+  load_filter(ctx, path, args_bool(args, "-preload"));
+  load_prefilter(ctx, args_uint(args, "-pf", 0));
 
   ctx->quiet = args_bool(args, "-q");
   char *outfile = arg_str(args, "-o");
@@ -828,28 +1346,32 @@ void init(ctx_t *ctx, args_t *args) {
 
   ctx->use_endo = args_bool(args, "-endo");
   if (ctx->cmd == CMD_MUL) ctx->use_endo = false; // no endo for mul command
+  bool group_fixed = load_group_size(ctx, args);
 
   pthread_mutex_init(&ctx->lock, NULL);
   int cpus = get_cpu_count();
   ctx->threads_count = MIN(MAX(args_uint(args, "-t", cpus), 1ul), 320ul);
-  ctx->threads = malloc(ctx->threads_count * sizeof(pthread_t));
+  ctx->workers = aligned_alloc(alignof(worker_t), ctx->threads_count * sizeof(worker_t));
+  memset(ctx->workers, 0, ctx->threads_count * sizeof(worker_t));
+  for (size_t i = 0; i < ctx->threads_count; ++i) ctx->workers[i].ctx = ctx;
   ctx->finished = false;
-  ctx->k_checked = 0;
   ctx->k_found = 0;
   ctx->ts_started = tsnow();
-  ctx->ts_updated = ctx->ts_started;
-  ctx->ts_printed = ctx->ts_started - 5e3;
   ctx->paused_time = 0;
   ctx->paused = false;
 
-  arg_search_range(args, ctx->range_s, ctx->range_e);
+  size_t range_min = group_fixed ? ctx->group_size : GROUP_INV_SIZE;
+  arg_search_range(args, ctx->range_s, ctx->range_e, ctx->group_size, range_min);
+  if (!group_fixed && arg_str(args, "-r") != NULL) fit_group_size(ctx);
   load_offs_size(ctx, args);
   queue_init(&ctx->queue, ctx->threads_count * 3);
 
-  printf("threads: %zu ~ addr33: %d ~ addr65: %d ~ endo: %d | filter: ", //
-         ctx->threads_count, ctx->check_addr33, ctx->check_addr65, ctx->use_endo);
+  printf("threads: %zu ~ addr33: %d ~ addr65: %d ~ endo: %d ~ group: %zu | filter: ", //
+         ctx->threads_count, ctx->check_addr33, ctx->check_addr65, ctx->use_endo,
+         ctx->group_size);
 
-  if (ctx->to_find_hashes != NULL) printf("list (%'zu)\n", ctx->to_find_count);
+  if (ctx->hidx.hashes != NULL) printf("list (%'zu)\n", ctx->hidx.count);
+  else if (ctx->fuse.fps != NULL) printf("fuse\n");
   else printf("bloom\n");
 
   if (ctx->cmd == CMD_ADD) {
@@ -859,6 +1381,18 @@ void init(ctx_t *ctx, args_t *args) {
 
   if (ctx->cmd == CMD_MUL) {
     ctx->raw_text = args_bool(args, "-raw");
+
+    char *in = arg_str(args, "-in");
+    ctx->bin_input = in != NULL && strcmp(in, "bin") == 0;
+    if (in != NULL && !ctx->bin_input && strcmp(in, "hex") != 0) {
+      fprintf(stderr, "invalid input format, use: -in hex or -in bin\n");
+      exit(1);
+    }
+
+    if (ctx->bin_input && ctx->raw_text) {
+      fprintf(stderr, "-raw can't be used with -in bin\n");
+      exit(1);
+    }
   }
 
   printf("----------------------------------------\n");